@@ -2,33 +2,306 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-int64_t shlf(int64_t a, int64_t b) {return a<<b;};
+int64_t simd_level = 0;
 
-int64_t shrf(int64_t a, int64_t b) {return a>>b;};
+// Vectorized loops built with --simd=dispatch pick their code by this
+__attribute__((constructor)) static void detect_simd(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        simd_level = 2;
+    }
+    else if (__builtin_cpu_supports("sse4.2")) {
+        simd_level = 1;
+    }
+};
 
-int64_t cmp_less(int64_t a, int64_t b) {return a < b;};
+// print writes into one buffer that goes out when full and at exit, or
+// after every number when stdout is a terminal
+#define OUT_SIZE (1 << 16)
+static char out_buf[OUT_SIZE];
+static size_t out_len = 0;
+static int out_tty = 0;
 
-int64_t cmp_great(int64_t a, int64_t b) {return a > b;};
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
 
-int64_t cmp_eq(int64_t a, int64_t b) {return a == b;};
+void flush_output(void) {
+    size_t done = 0;
+    while (done < out_len) {
+        ssize_t n = write(STDOUT_FILENO, out_buf + done, out_len - done);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { break; }
+        done += n;
+    }
+    out_len = 0;
+};
 
-int64_t cmp_neq(int64_t a, int64_t b) {return a != b;};
+__attribute__((constructor)) static void init_output(void) {
+    out_tty = isatty(STDOUT_FILENO);
+    atexit(flush_output);
+};
 
-int64_t cmp_leq(int64_t a, int64_t b) {return a <= b;};
+// Two digits per division, right to left
+static inline void put_int(int64_t val) {
+    // "-9223372036854775808\n"
+    if (out_len > OUT_SIZE - 21) { flush_output(); }
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    uint64_t u = val < 0 ? 0 - (uint64_t)val : (uint64_t)val;
+    while (u >= 100) {
+        p -= 2;
+        memcpy(p, DIGIT_PAIRS + 2 * (u % 100), 2);
+        u /= 100;
+    }
+    if (u >= 10) {
+        p -= 2;
+        memcpy(p, DIGIT_PAIRS + 2 * u, 2);
+    }
+    else {
+        *--p = '0' + u;
+    }
+    if (val < 0) { *--p = '-'; }
+
+    memcpy(out_buf + out_len, p, end - p);
+    out_len += end - p;
+    out_buf[out_len++] = '\n';
+};
+
+void print_int(int64_t val) {
+    put_int(val);
+    if (out_tty) { flush_output(); }
+};
+
+void print_array(int64_t* arr, int64_t n) {
+    for (int64_t i = 0; i < n; ++i) { put_int(arr[i]); }
+    if (out_tty) { flush_output(); }
+};
 
-int64_t cmp_geq(int64_t a, int64_t b) {return a >= b;};
+// scan reads from stdin mapped whole when it is a regular file, through a
+// buffer filled by read() otherwise
+#define IN_SIZE (1 << 16)
+static char in_buf[IN_SIZE];
+static const char* in_pos = in_buf;
+static const char* in_end = in_buf;
+static int in_mapped = 0;
 
-int64_t* dyn_malloc(int n, int val) {
-    int64_t* arr = malloc(n * sizeof(int64_t));
-    
-    for (size_t i = 0; i < n; ++i) {
-        arr[i] = val;
+__attribute__((constructor)) static void init_input(void) {
+    struct stat st;
+    if (fstat(STDIN_FILENO, &st) != 0 || !S_ISREG(st.st_mode)) { return; }
+    off_t start = lseek(STDIN_FILENO, 0, SEEK_CUR);
+    if (start < 0 || start >= st.st_size) { return; }
+    char* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+    if (data == MAP_FAILED) { return; }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    in_pos = data + start;
+    in_end = data + st.st_size;
+    in_mapped = 1;
+};
+
+// Returns 0 once the input is over
+static int fill_input(void) {
+    if (in_mapped) { return 0; }
+    ssize_t n;
+    do {
+        n = read(STDIN_FILENO, in_buf, IN_SIZE);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) { return 0; }
+    in_pos = in_buf;
+    in_end = in_buf + n;
+    return 1;
+};
+
+// The reader works on a local copy of the cursor, written back once per
+// scan, so the compiler can keep it in a register
+static inline int peek_input(const char** p, const char** end) {
+    if (*p == *end) {
+        in_pos = *p;
+        if (!fill_input()) { return -1; }
+        *p = in_pos;
+        *end = in_end;
+    }
+    return (unsigned char)**p;
+};
+
+// Skips whitespace and reads an optionally signed decimal, 0 at the end of
+// the input or when no number follows
+static inline __attribute__((always_inline)) int64_t read_int(const char** p, const char** end) {
+    int c = peek_input(p, end);
+    while (c == ' ' || (c >= '\t' && c <= '\r')) {
+        ++*p;
+        c = peek_input(p, end);
+    }
+    int neg = c == '-';
+    if (c == '-' || c == '+') {
+        ++*p;
+        c = peek_input(p, end);
+    }
+    uint64_t val = 0;
+    while (c >= '0' && c <= '9') {
+        val = val * 10 + (c - '0');
+        ++*p;
+        c = peek_input(p, end);
+    }
+    return neg ? 0 - val : val;
+};
+
+int64_t scan_int(void) {
+    const char* p = in_pos;
+    const char* end = in_end;
+    int64_t val = read_int(&p, &end);
+    in_pos = p;
+    return val;
+};
+
+void scan_array(int64_t* arr, int64_t n) {
+    const char* p = in_pos;
+    const char* end = in_end;
+    for (int64_t i = 0; i < n; ++i) { arr[i] = read_int(&p, &end); }
+    in_pos = p;
+};
+
+// Arrays start on a cache line. The pointer malloc handed out sits in the
+// word right before the array so dyn_free can give it back, and the length
+// in the one before that for bounds checks.
+#define ARR_ALIGN 64
+#define ARR_PAGE 4096
+// from here on the kernel may back the array with 2 MiB pages
+#define ARR_HUGE (2 << 20)
+
+int64_t* dyn_malloc(int64_t n, int64_t val) {
+    if (n < 0) { n = 0; }
+    if ((uint64_t)n > (SIZE_MAX - ARR_ALIGN) / sizeof(int64_t)) {
+        fprintf(stderr, "Array of %ld elements is too large\n", (long)n);
+        exit(EXIT_FAILURE);
+    }
+    size_t bytes = n * sizeof(int64_t);
+    // calloc gets fresh pages for large blocks and skips clearing those
+    char* raw = val == 0 ? calloc(1, bytes + ARR_ALIGN) : malloc(bytes + ARR_ALIGN);
+    if (!raw) {
+        fprintf(stderr, "Out of memory for an array of %ld elements\n", (long)n);
+        exit(EXIT_FAILURE);
+    }
+    int64_t* arr = (int64_t*)(((uintptr_t)raw + ARR_ALIGN) & ~(uintptr_t)(ARR_ALIGN - 1));
+    ((char**)arr)[-1] = raw;
+    arr[-2] = n;
+
+    if (bytes >= ARR_HUGE) {
+        uintptr_t lo = ((uintptr_t)arr + ARR_PAGE - 1) & ~(uintptr_t)(ARR_PAGE - 1);
+        uintptr_t hi = ((uintptr_t)arr + bytes) & ~(uintptr_t)(ARR_PAGE - 1);
+        madvise((void*)lo, hi - lo, MADV_HUGEPAGE);
+    }
+
+    if (val == 0 || n == 0) { return arr; }
+    // the same byte eight times is one memset, anything else doubles the
+    // filled prefix with memcpy
+    uint64_t byte = (uint8_t)val;
+    if ((uint64_t)val == byte * 0x0101010101010101ull) {
+        memset(arr, (int)byte, bytes);
+        return arr;
+    }
+    arr[0] = val;
+    for (size_t done = 1; done < (size_t)n; done *= 2) {
+        size_t len = done < (size_t)n - done ? done : (size_t)n - done;
+        memcpy(arr + done, arr, len * sizeof(int64_t));
     }
-    
     return arr;
 };
 
-void set(int64_t* arr, int64_t pos, int64_t val) {arr[pos] = val;};
+void dyn_free(int64_t* arr) {
+    if (arr) { free(((char**)arr)[-1]); }
+};
+
+void bounds_fail(int64_t line, int64_t index, int64_t length) {
+    flush_output();
+    fprintf(stderr, "Line %ld: index %ld is out of bounds for an array of length %ld\n", (long)line, (long)index, (long)length);
+    exit(EXIT_FAILURE);
+};
+
+// One open-addressing table per function marked @memo. An entry is a
+// word telling whether it is in use, the value, then the n key words.
+typedef struct {
+    int64_t* slots;
+    int64_t n;
+    int64_t cap;
+    int64_t count;
+} MemoTable;
+
+static MemoTable* memo_tables = NULL;
+static int64_t memo_num_tables = 0;
+
+static MemoTable* memo_table(int64_t table, int64_t n) {
+    if (table >= memo_num_tables) {
+        int64_t num = table + 1;
+        memo_tables = realloc(memo_tables, num * sizeof(MemoTable));
+        if (!memo_tables) {
+            fprintf(stderr, "Out of memory for memo tables\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(memo_tables + memo_num_tables, 0, (num - memo_num_tables) * sizeof(MemoTable));
+        memo_num_tables = num;
+    }
+    memo_tables[table].n = n;
+    return &memo_tables[table];
+};
+
+static inline uint64_t memo_hash(const int64_t* key, int64_t n) {
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+    for (int64_t i = 0; i < n; ++i) {
+        h = (h ^ (uint64_t)key[i]) * 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 31;
+    }
+    return h;
+};
+
+// The entry holding key, or the empty one it would go into
+static inline int64_t* memo_probe(MemoTable* t, const int64_t* key) {
+    int64_t words = t->n + 2;
+    uint64_t mask = t->cap - 1;
+    for (uint64_t i = memo_hash(key, t->n) & mask;; i = (i + 1) & mask) {
+        int64_t* entry = t->slots + i * words;
+        if (!entry[0] || memcmp(entry + 2, key, t->n * sizeof(int64_t)) == 0) { return entry; }
+    }
+};
+
+int64_t memo_lookup(int64_t table, const int64_t* key, int64_t n) {
+    MemoTable* t = memo_table(table, n);
+    if (!t->count) { return MEMO_MISSING; }
+    int64_t* entry = memo_probe(t, key);
+    return entry[0] ? entry[1] : MEMO_MISSING;
+};
 
-int64_t get(int64_t* arr, int64_t pos) {return arr[pos];};
+void memo_store(int64_t table, const int64_t* key, int64_t n, int64_t value) {
+    MemoTable* t = memo_table(table, n);
+    int64_t words = n + 2;
+    // kept at most half full
+    if ((t->count + 1) * 2 > t->cap) {
+        MemoTable grown = {NULL, n, t->cap ? t->cap * 2 : 64, t->count};
+        grown.slots = calloc(grown.cap, words * sizeof(int64_t));
+        if (!grown.slots) {
+            fprintf(stderr, "Out of memory for a memo table of %ld entries\n", (long)grown.cap);
+            exit(EXIT_FAILURE);
+        }
+        for (int64_t i = 0; i < t->cap; ++i) {
+            int64_t* entry = t->slots + i * words;
+            if (entry[0]) { memcpy(memo_probe(&grown, entry + 2), entry, words * sizeof(int64_t)); }
+        }
+        free(t->slots);
+        *t = grown;
+    }
+    int64_t* entry = memo_probe(t, key);
+    if (!entry[0]) {
+        entry[0] = 1;
+        memcpy(entry + 2, key, n * sizeof(int64_t));
+        t->count += 1;
+    }
+    entry[1] = value;
+};
@@ -4,18 +4,23 @@
 #ifndef ASM_OPS_H
 #define ASM_OPS_H
 
-int64_t shlf(int64_t a, int64_t b);
-int64_t shrf(int64_t a, int64_t b);
+void print_int(int64_t val);
+void flush_output(void);
+int64_t scan_int(void);
+void print_array(int64_t* arr, int64_t n);
+void scan_array(int64_t* arr, int64_t n);
 
-int64_t cmp_less(int64_t a, int64_t b);
-int64_t cmp_great(int64_t a, int64_t b);
-int64_t cmp_eq(int64_t a, int64_t b);
-int64_t cmp_neq(int64_t a, int64_t b);
-int64_t cmp_leq(int64_t a, int64_t b);
-int64_t cmp_geq(int64_t a, int64_t b);
+// 2 with AVX2, 1 with SSE4.2, 0 otherwise
+extern int64_t simd_level;
 
-int64_t* dyn_malloc(int n, int val);
-void set(int64_t* arr, int64_t pos, int64_t val);
-int64_t get(int64_t* arr, int64_t pos);
+int64_t* dyn_malloc(int64_t n, int64_t val);
+void dyn_free(int64_t* arr);
+// Reports a failed bounds check and exits
+void bounds_fail(int64_t line, int64_t index, int64_t length);
+// Results of the functions marked @memo, a table per function keyed on
+// the n arguments; lookups of keys not stored yet give MEMO_MISSING
+#define MEMO_MISSING INT64_MIN
+int64_t memo_lookup(int64_t table, const int64_t* key, int64_t n);
+void memo_store(int64_t table, const int64_t* key, int64_t n, int64_t value);
 
 #endif
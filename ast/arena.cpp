@@ -0,0 +1,72 @@
+#include "arena.hpp"
+
+Arena ast_arena;
+
+static size_t align_up(size_t n) {
+    const size_t a = alignof(std::max_align_t);
+    return (n + a - 1) & ~(a - 1);
+}
+
+Arena::Arena(size_t _block_size) { block_size = _block_size; };
+
+Arena::~Arena() { release(); };
+
+void* Arena::alloc(size_t size) {
+    size = align_up(size);
+    size_t hdr = align_up(sizeof(Block));
+    
+    // Oversized requests get a block of their own, the current one stays open
+    if (size > block_size / 2) {
+        Block* block = (Block*)::operator new(hdr + size);
+        block->prev = head;
+        block->size = hdr + size;
+        head = block;
+        
+        used_total += size;
+        return (char*)block + hdr;
+    }
+    
+    if (cur == nullptr || (size_t)(end - cur) < size) {
+        Block* block = (Block*)::operator new(block_size);
+        block->prev = head;
+        block->size = block_size;
+        head = block;
+        
+        cur = (char*)block + hdr;
+        end = (char*)block + block_size;
+    }
+    
+    void* res = cur;
+    cur += size;
+    used_total += size;
+    
+    return res;
+};
+
+std::string* Arena::intern(const char* s) {
+    auto it = strings.find(std::string_view(s));
+    if (it != strings.end()) { return it->second; }
+    
+    std::string* str = make<std::string>(s);
+    strings[std::string_view(*str)] = str;
+    
+    return str;
+};
+
+void Arena::release() {
+    strings.clear();
+    
+    for (DtorLink* link = dtors; link != nullptr; link = link->next) {
+        link->dtor((char*)link + sizeof(DtorLink));
+    }
+    dtors = nullptr;
+    
+    while (head != nullptr) {
+        Block* prev = head->prev;
+        ::operator delete(head);
+        head = prev;
+    }
+    
+    cur = end = nullptr;
+    used_total = 0;
+};
@@ -0,0 +1,70 @@
+#include <cstddef>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+// Bump allocator that owns everything the compiler builds for one source
+// file (AST nodes, token strings, diagnostics) and frees it in one go.
+// Objects with non-trivial destructors are threaded on an intrusive list
+// so release() can run their destructors before dropping the blocks.
+class Arena {
+public:
+    Arena(size_t _block_size = 64 * 1024);
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        if (std::is_trivially_destructible<T>::value) {
+            return new (alloc(sizeof(T))) T(std::forward<Args>(args)...);
+        }
+        
+        char* mem = (char*)alloc(sizeof(DtorLink) + sizeof(T));
+        T* obj = new (mem + sizeof(DtorLink)) T(std::forward<Args>(args)...);
+        
+        DtorLink* link = (DtorLink*)mem;
+        link->dtor = [](void* p) { static_cast<T*>(p)->~T(); };
+        link->next = dtors;
+        dtors = link;
+        
+        return obj;
+    }
+    
+    // Returns the unique arena-owned copy of s
+    std::string* intern(const char* s);
+    
+    void* alloc(size_t size);
+    void release();
+    
+    size_t bytes_used() const { return used_total; }
+private:
+    struct Block {
+        Block* prev;
+        size_t size;
+    };
+    
+    // Sized to keep the object behind it max-aligned
+    struct alignas(std::max_align_t) DtorLink {
+        void (*dtor)(void*);
+        DtorLink* next;
+    };
+    
+    size_t block_size;
+    Block* head = nullptr;
+    char* cur = nullptr;
+    char* end = nullptr;
+    DtorLink* dtors = nullptr;
+    size_t used_total = 0;
+    std::unordered_map<std::string_view, std::string*> strings;
+};
+
+extern Arena ast_arena;
+
+#endif
@@ -11,162 +11,14 @@
 #include <iterator>
 #include <utility>
 
-const int VAR_STEP = 4;
-
-int get_size(int n) {
-    int i = 16;    
-    while (i < n) i += 16;
-    return i;
-}
-
-void num_of_scans(ASTNode* ptr, int* num) {
-    auto* num_node = dynamic_cast<NumNode*>(ptr);
-    auto* var_node = dynamic_cast<VarNode*>(ptr);
-    auto* arrElem_node = dynamic_cast<ArrayElemNode*>(ptr);
-    auto* bin_op_node = dynamic_cast<BinaryNode*>(ptr);
-    auto* main_node = dynamic_cast<MainNode*>(ptr);
-    auto* assign_node = dynamic_cast<AssignNode*>(ptr);
-    auto* print_node = dynamic_cast<PrintNode*>(ptr);
-    auto* scan_node = dynamic_cast<ScanNode*>(ptr);
-    auto* statArrDecl_node = dynamic_cast<StatArrayDeclNode*>(ptr);
-    auto* dynArrDecl_node = dynamic_cast<DynArrayDeclNode*>(ptr);
-    auto* arrElemAssign_node = dynamic_cast<ArrayElemAssignNode*>(ptr);
-    auto* if_else_node = dynamic_cast<IfElseNode*>(ptr);
-    auto* while_node = dynamic_cast<WhileNode*>(ptr);
-    auto* funcDef_node = dynamic_cast<FuncDef*>(ptr);
-    auto* funcCall_node = dynamic_cast<FuncCall*>(ptr);
-    
-    if (num_node) { return; }
-    else if (var_node) { return; }
-    else if (arrElem_node) { return; }
-    else if (bin_op_node) {
-        num_of_scans(bin_op_node->left, num);
-        num_of_scans(bin_op_node->right, num);
-    }
-    else if (main_node) {
-        num_of_scans(main_node->next, num);
-    }
-    else if (assign_node) {
-        num_of_scans(assign_node->next, num);
-    }
-    else if (arrElemAssign_node) {
-        num_of_scans(arrElemAssign_node->next, num);
-    }
-    else if (print_node) {
-        num_of_scans(print_node->next, num);
-    }
-    else if (scan_node) {
-        *num += 1;
-        num_of_scans(scan_node->next, num);
-    }
-    else if (statArrDecl_node) {
-        num_of_scans(statArrDecl_node->next, num);
-    }
-    else if (dynArrDecl_node) {
-        num_of_scans(dynArrDecl_node->next, num);
-    }
-    else if (if_else_node) {
-        int n = if_else_node->conds.size();
-        
-        if (n == 1) {
-            num_of_scans(if_else_node->conds[0].second, num);
-            num_of_scans(if_else_node->next, num);
-        }
-        else {
-            for (int i = 0; i < n; ++i) {
-                num_of_scans(if_else_node->conds[i].second, num);
-            }
-            
-            num_of_scans(if_else_node->next, num);
-        }
-    }
-    else if (while_node) {
-        num_of_scans(while_node->stmts, num);
-        num_of_scans(while_node->next, num); 
-    }
-    else if (funcDef_node) { num_of_scans(funcDef_node->next, num); }
-    else if (funcCall_node) { return; }
-    else { return; }
+Result* ok_result() {
+    static Result ok(ErrType::_OK_, -1, "");
+    return &ok;
 };
 
-int num_vars(ASTNode* ptr, int res) {
-    auto* num_node = dynamic_cast<NumNode*>(ptr);
-    auto* var_node = dynamic_cast<VarNode*>(ptr);
-    auto* bin_op_node = dynamic_cast<BinaryNode*>(ptr);
-    
-    if (num_node) { res = 0; }
-    else if (var_node) { res = 1; }
-    else if (bin_op_node) {
-        res = num_vars(bin_op_node->left, res) + num_vars(bin_op_node->right, res);
-    }
-    else { return 0; }
-    
-    return res;
-}
-
-int num_expr_eval(ASTNode* ptr, int res) {
-    auto* num_node = dynamic_cast<NumNode*>(ptr);
-    auto* bin_op_node = dynamic_cast<BinaryNode*>(ptr);
-    
-    if (num_node) { res = num_node->num; }
-    else if (bin_op_node) {
-        switch (bin_op_node->tag) {
-            case _ADD_:
-                res = num_expr_eval(bin_op_node->left, res) + num_expr_eval(bin_op_node->right, res);
-                break;
-            case _SUB_:
-                res = num_expr_eval(bin_op_node->left, res) - num_expr_eval(bin_op_node->right, res);
-                break;
-            case _MUL_:
-                res = num_expr_eval(bin_op_node->left, res) * num_expr_eval(bin_op_node->right, res);
-                break;
-            case _DIV_:
-                res = num_expr_eval(bin_op_node->left, res) / num_expr_eval(bin_op_node->right, res);
-                break;
-            case _MOD_:
-                res = num_expr_eval(bin_op_node->left, res) % num_expr_eval(bin_op_node->right, res);
-                break;
-            case _SHL_:
-                res = num_expr_eval(bin_op_node->left, res) << num_expr_eval(bin_op_node->right, res);
-                break;
-            case _SHR_:
-                res = num_expr_eval(bin_op_node->left, res) % num_expr_eval(bin_op_node->right, res);
-                break;
-            case _LESS_:
-                res = num_expr_eval(bin_op_node->left, res) < num_expr_eval(bin_op_node->right, res);
-                break;
-            case _GREAT_:
-                res = num_expr_eval(bin_op_node->left, res) > num_expr_eval(bin_op_node->right, res);
-                break;
-            case _EQ_:
-                res = num_expr_eval(bin_op_node->left, res) == num_expr_eval(bin_op_node->right, res);
-                break;
-            case _NEQ_:
-                res = num_expr_eval(bin_op_node->left, res) != num_expr_eval(bin_op_node->right, res);
-                break;
-            case _GEQ_:
-                res = num_expr_eval(bin_op_node->left, res) >= num_expr_eval(bin_op_node->right, res);
-                break;
-            case _LEQ_:
-                res = num_expr_eval(bin_op_node->left, res) <= num_expr_eval(bin_op_node->right, res);
-                break;
-            case _AND_:
-                res = num_expr_eval(bin_op_node->left, res) && num_expr_eval(bin_op_node->right, res);
-                break;
-            case _OR_:
-                res = num_expr_eval(bin_op_node->left, res) || num_expr_eval(bin_op_node->right, res);
-                break;
-            case _NOT_:
-                res = !num_expr_eval(bin_op_node->right, res);
-                break;
-            case _NEG_:
-                res = -num_expr_eval(bin_op_node->right, res);
-                break;
-        }
-    }
-    
-    return res;
-}
+Result* err_result(ErrType err, int err_index, std::string msg) {
+    return ast_arena.make<Result>(err, err_index, msg);
+};
 
 bool errResult(Result* tmp) {
     switch (tmp->err) {
@@ -186,6 +38,10 @@ bool errResult(Result* tmp) {
             return true; 
             break;
         }
+        case ErrType::_ERR_MEMO_ : {
+            return true; 
+            break;
+        }
         default : {
             return false;
             break;
@@ -193,20 +49,23 @@ bool errResult(Result* tmp) {
     };
 };
 
-NumNode::NumNode(int _line_index, int _num) { line_index = _line_index; num = _num; };
+NumNode::NumNode(int _line_index, int _num) { kind = _NUM_NODE_; line_index = _line_index; num = _num; };
 
 VarNode::VarNode(int _line_index, std::string _var_name) { 
+    kind = _VAR_NODE_;
     line_index = _line_index; 
     var_name = _var_name; 
 };
 
 ArrayElemNode::ArrayElemNode(int _line_index, std::string _arr_name, ASTNode* _elem_index) {
+    kind = _ARR_ELEM_NODE_;
     line_index = _line_index;
     arr_name = _arr_name;
     elem_index = _elem_index;
 };
 
 BinaryNode::BinaryNode(int _line_index, Tag _tag, ASTNode* _left, ASTNode* _right) {
+    kind = _BIN_OP_NODE_;
     line_index = _line_index;
     tag = _tag;
     left = _left;
@@ -214,18 +73,21 @@ BinaryNode::BinaryNode(int _line_index, Tag _tag, ASTNode* _left, ASTNode* _righ
 };
 
 FuncCall::FuncCall(int _line_index, std::string _func_name, std::vector<ASTNode*> _func_args) {
+    kind = _FUNC_CALL_NODE_;
     line_index = _line_index;
     func_name = _func_name;
     func_args = _func_args;
 };
 
 MainNode::MainNode(int _line_index, ASTNode* _next) {
+    kind = _MAIN_NODE_;
     line_index = _line_index;
     next = _next;
 };
 
 AssignNode::AssignNode(int _line_index, std::string _var_name, VarType _assign_ty, 
     ASTNode* _assign_val, ASTNode* _next) {
+    kind = _ASSIGN_NODE_;
     line_index = _line_index;
     var_name = _var_name;
     assign_ty = _assign_ty;
@@ -235,6 +97,7 @@ AssignNode::AssignNode(int _line_index, std::string _var_name, VarType _assign_t
 
 StatArrayDeclNode::StatArrayDeclNode(int _line_index, std::string _arr_name, int _arr_size, 
     std::vector<ASTNode*> _arr_vals, ASTNode* _next) {
+    kind = _STAT_ARR_DECL_NODE_;
     line_index = _line_index;
     arr_name = _arr_name;
     arr_size = _arr_size;
@@ -242,10 +105,10 @@ StatArrayDeclNode::StatArrayDeclNode(int _line_index, std::string _arr_name, int
     next = _next;
 };
 
-DynArrayDeclNode::DynArrayDeclNode(int _line_index, int _arrayDecl_loop, std::string _arr_name, ASTNode* _arr_size, 
+DynArrayDeclNode::DynArrayDeclNode(int _line_index, std::string _arr_name, ASTNode* _arr_size, 
     ASTNode* _arr_val, ASTNode* _next) {
+    kind = _DYN_ARR_DECL_NODE_;
     line_index = _line_index;
-    arrayDecl_loop = _arrayDecl_loop;
     arr_name = _arr_name;
     arr_size = _arr_size;
     arr_val = _arr_val;
@@ -254,6 +117,7 @@ DynArrayDeclNode::DynArrayDeclNode(int _line_index, int _arrayDecl_loop, std::st
 
 ArrayElemAssignNode::ArrayElemAssignNode(int _line_index, std::string _arr_name, ASTNode* _elem_index, 
     ASTNode* _assign_val, ASTNode* _next) {
+    kind = _ARR_ELEM_ASSIGN_NODE_;
     line_index = _line_index;
     arr_name = _arr_name;
     elem_index = _elem_index;
@@ -262,1405 +126,602 @@ ArrayElemAssignNode::ArrayElemAssignNode(int _line_index, std::string _arr_name,
 };
 
 PrintNode::PrintNode(int _line_index, ASTNode* _print_val, ASTNode* _next) {
+    kind = _PRINT_NODE_;
     line_index = _line_index;
     print_val = _print_val;
     next = _next;
 };
 
 ScanNode::ScanNode(int _line_index, std::string _var_name, ASTNode* _next) {
+    kind = _SCAN_NODE_;
     line_index = _line_index;
     var_name = _var_name;
     next = _next;
 };
 
-IfElseNode::IfElseNode(int _line_index, int _if_num, int _main_num, std::vector<std::pair<ASTNode*, ASTNode*>> _conds, std::vector<int> _cond_num, ASTNode* _next) {
+ArrayPrintNode::ArrayPrintNode(int _line_index, std::string _arr_name, ASTNode* _count, ASTNode* _next) {
+    kind = _ARR_PRINT_NODE_;
+    line_index = _line_index;
+    arr_name = _arr_name;
+    count = _count;
+    next = _next;
+};
+
+ArrayScanNode::ArrayScanNode(int _line_index, std::string _arr_name, ASTNode* _count, ASTNode* _next) {
+    kind = _ARR_SCAN_NODE_;
+    line_index = _line_index;
+    arr_name = _arr_name;
+    count = _count;
+    next = _next;
+};
+
+IfElseNode::IfElseNode(int _line_index, std::vector<std::pair<ASTNode*, ASTNode*>> _conds, ASTNode* _next) {
+    kind = _IF_ELSE_NODE_;
     line_index = _line_index;
-    if_num = _if_num;
-    main_num = _main_num;
     conds = _conds;
-    cond_num = _cond_num;
     next = _next;
 };
 
-WhileNode::WhileNode(int _line_index, int _while_num, int _main_num, ASTNode* _cond, ASTNode* _stmts, ASTNode* _next) {
+WhileNode::WhileNode(int _line_index, ASTNode* _cond, ASTNode* _stmts, ASTNode* _next) {
+    kind = _WHILE_NODE_;
     line_index = _line_index;
-    while_num = _while_num;
-    main_num = _main_num;
     cond = _cond; 
     stmts = _stmts; 
     next = _next;
 };
 
 ReturnNode::ReturnNode(int _line_index, ASTNode* _return_val, ASTNode* _next) {
+    kind = _RETURN_NODE_;
     line_index = _line_index;
     return_val = _return_val;
     next = _next;
 };
 
-FuncDef::FuncDef(int _line_index, std::string _func_name, std::vector<ASTNode*> _func_args, FuncState _func_state, 
-        ASTNode* _func_stmts, ASTNode* _next) {
+FuncDef::FuncDef(int _line_index, std::string _func_name, std::vector<ASTNode*> _func_args, ASTNode* _func_stmts, ASTNode* _next) {
+    kind = _FUNC_DEF_NODE_;
     line_index = _line_index;
     func_name = _func_name;
     func_args = _func_args;
-    func_state = _func_state;
     func_stmts = _func_stmts;
+    memo = false;
+    impure_line = 0;
     next = _next;
 };
 
-Result* FuncDef::traverse_func_tree(ASTNode* ptr, ProgState state) {
-    auto* num_node = dynamic_cast<NumNode*>(ptr);
-    auto* var_node = dynamic_cast<VarNode*>(ptr);
-    auto* arrElem_node = dynamic_cast<ArrayElemNode*>(ptr);
-    auto* bin_op_node = dynamic_cast<BinaryNode*>(ptr);
-    auto* main_node = dynamic_cast<MainNode*>(ptr);
-    auto* assign_node = dynamic_cast<AssignNode*>(ptr);
-    auto* arrElemAssign_node = dynamic_cast<ArrayElemAssignNode*>(ptr);
-    auto* statArrDecl_node = dynamic_cast<StatArrayDeclNode*>(ptr);
-    auto* dynArrDecl_node = dynamic_cast<DynArrayDeclNode*>(ptr);
-    auto* if_else_node = dynamic_cast<IfElseNode*>(ptr);
-    auto* while_node = dynamic_cast<WhileNode*>(ptr);
-    auto* return_node = dynamic_cast<ReturnNode*>(ptr);
-    auto* funcCall_node = dynamic_cast<FuncCall*>(ptr);
+Result* FuncDef::traverse_func_tree(ASTNode* ptr, ProgState* state) {
+    if (!ptr) { return ok_result(); }
     
-    if (num_node) { 
-        return new Result(ErrType::_OK_, -1, "") ; 
-    }
-    else if (var_node) {
-        if (this->func_state.vars.find(var_node->var_name) == this->func_state.vars.end()) {
-            return new Result(ErrType::_ERR_VAR_, var_node->line_index, "Variable '" + var_node->var_name + "' not defined!");
+    switch (ptr->kind) {
+        case _NUM_NODE_ : {
+            return ok_result(); 
         }
-    }
-    else if (arrElem_node) {
-        if (this->func_state.arrs.find(arrElem_node->arr_name) == this->func_state.arrs.end()) {
-            std::string arr = arrElem_node->arr_name.substr(1, arrElem_node->arr_name.length()-2);
-            return new Result(ErrType::_ERR_ARR_, arrElem_node->line_index, "Unknown array '" + arr + "'!");
+        case _VAR_NODE_ : {
+            auto* var_node = static_cast<VarNode*>(ptr);
+            var_node->sym = state->symtab.lookup(var_node->var_name, _SYM_VAR_);
+            if (!var_node->sym) {
+                return err_result(ErrType::_ERR_VAR_, var_node->line_index, "Variable '" + var_node->var_name + "' not defined!");
+            }
+            break;
         }
-        else {
-            Result* index = traverse_func_tree(arrElem_node->elem_index, state);
-            if (errResult(index)) return index;
+        case _ARR_ELEM_NODE_ : {
+            auto* arrElem_node = static_cast<ArrayElemNode*>(ptr);
+            arrElem_node->sym = state->symtab.lookup(arrElem_node->arr_name, _SYM_ARR_);
+            if (!arrElem_node->sym) {
+                std::string arr = arrElem_node->arr_name.substr(1, arrElem_node->arr_name.length()-2);
+                return err_result(ErrType::_ERR_ARR_, arrElem_node->line_index, "Unknown array '" + arr + "'!");
+            }
+            else {
+                Result* index = traverse_func_tree(arrElem_node->elem_index, state);
+                if (errResult(index)) return index;
+            }
+            break;
         }
-    }
-    else if (bin_op_node) {
-        Result* lhs = traverse_func_tree(bin_op_node->left, state);
-        Result* rhs = traverse_func_tree(bin_op_node->right, state);
+        case _BIN_OP_NODE_ : {
+            auto* bin_op_node = static_cast<BinaryNode*>(ptr);
+            Result* lhs = traverse_func_tree(bin_op_node->left, state);
+            Result* rhs = traverse_func_tree(bin_op_node->right, state);
         
-        if (errResult(lhs)) return lhs;
-        else if (errResult(rhs)) return rhs;
-    }
-    else if (main_node) {
-        Result* res = traverse_func_tree(main_node->next, state);
-        if (errResult(res)) return res;
-    }
-    else if (assign_node) {
-        Result* val = traverse_func_tree(assign_node->assign_val, state);
-        if (errResult(val)) return val;
+            if (errResult(lhs)) return lhs;
+            else if (errResult(rhs)) return rhs;
+            break;
+        }
+        case _MAIN_NODE_ : {
+            auto* main_node = static_cast<MainNode*>(ptr);
+            Result* res = traverse_func_tree(main_node->next, state);
+            if (errResult(res)) return res;
+            break;
+        }
+        case _ASSIGN_NODE_ : {
+            auto* assign_node = static_cast<AssignNode*>(ptr);
+            Result* val = traverse_func_tree(assign_node->assign_val, state);
+            if (errResult(val)) return val;
         
-        auto it = this->func_state.vars.find(assign_node->var_name);
-        switch (assign_node->assign_ty) {
-            case VarType::_VAR_ : {
-                if (it == this->func_state.vars.end()) {
-                    this->func_state.vars[assign_node->var_name] = this->func_state.var_counter;
-                    this->func_state.var_counter += VAR_STEP;
-                } 
-                break;
-            }
-            case VarType::_CONST_ : {
-                if (it == this->func_state.vars.end()) {
-                    this->func_state.vars[assign_node->var_name] = this->func_state.var_counter;
-                    this->func_state.var_counter += VAR_STEP;
+            assign_node->sym = state->symtab.lookup(assign_node->var_name, _SYM_VAR_);
+            switch (assign_node->assign_ty) {
+                case VarType::_VAR_ : {
+                    if (!assign_node->sym) {
+                        assign_node->sym = state->symtab.define_var(assign_node->var_name, _VAR_);
+                    } 
+                    else if (assign_node->sym->var_ty == _CONST_) {
+                        return err_result(ErrType::_ERR_CONST_, assign_node->line_index, "Can't assign to const '" + assign_node->var_name + "'!!");
+                    }
+                    break;
                 }
-                else {
-                    return new Result(ErrType::_ERR_CONST_, assign_node->line_index, "Can't redefine const '" + assign_node->var_name + "'!!");
+                case VarType::_CONST_ : {
+                    if (!assign_node->sym) {
+                        assign_node->sym = state->symtab.define_var(assign_node->var_name, _CONST_);
+                    }
+                    else {
+                        return err_result(ErrType::_ERR_CONST_, assign_node->line_index, "Can't redefine const '" + assign_node->var_name + "'!!");
+                    }
+                    break;
                 }
-                break;
+                default : {break;}
             }
-            default : {break;}
-        }
-        Result* res = traverse_func_tree(assign_node->next, state);
-        if (errResult(res)) return res;
-    }
-    else if (arrElemAssign_node) {
-        if (this->func_state.arrs.find(arrElemAssign_node->arr_name) == this->func_state.arrs.end()) {
-            std::string arr = arrElemAssign_node->arr_name.substr(1, arrElemAssign_node->arr_name.length()-2);
-            return new Result(ErrType::_ERR_ARR_, arrElemAssign_node->line_index, "Unknown array '" + arr + "'!");
+            Result* res = traverse_func_tree(assign_node->next, state);
+            if (errResult(res)) return res;
+            break;
         }
-        else {
-            Result* index = traverse_func_tree(arrElemAssign_node->elem_index, state);
-            Result* val = traverse_func_tree(arrElemAssign_node->assign_val, state);
-            Result* res = traverse_func_tree(arrElemAssign_node->next, state);
+        case _ARR_ELEM_ASSIGN_NODE_ : {
+            auto* arrElemAssign_node = static_cast<ArrayElemAssignNode*>(ptr);
+            if (!impure_line) { impure_line = arrElemAssign_node->line_index; }
+            arrElemAssign_node->sym = state->symtab.lookup(arrElemAssign_node->arr_name, _SYM_ARR_);
+            if (!arrElemAssign_node->sym) {
+                std::string arr = arrElemAssign_node->arr_name.substr(1, arrElemAssign_node->arr_name.length()-2);
+                return err_result(ErrType::_ERR_ARR_, arrElemAssign_node->line_index, "Unknown array '" + arr + "'!");
+            }
+            else {
+                Result* index = traverse_func_tree(arrElemAssign_node->elem_index, state);
+                Result* val = traverse_func_tree(arrElemAssign_node->assign_val, state);
+                Result* res = traverse_func_tree(arrElemAssign_node->next, state);
             
-            if (errResult(index)) return index;
-            else if (errResult(val)) return val;
-            else if (errResult(res)) return res;
-        }
-    }
-    else if (statArrDecl_node) { //cnt = 4, n = 3 ==> {8, 12, 16}
-        auto it = this->func_state.arrs.find(statArrDecl_node->arr_name);
-        if (it == this->func_state.arrs.end()) { 
-            this->func_state.arrs[statArrDecl_node->arr_name] = {
-                this->func_state.var_counter + statArrDecl_node->arr_size*4, 
-                _STAT_
-            }; 
+                if (errResult(index)) return index;
+                else if (errResult(val)) return val;
+                else if (errResult(res)) return res;
+            }
+            break;
         }
-        
-        int n = statArrDecl_node->arr_size;
-        for (int i = n-1; i >= 0; --i) {
-            Result* val = traverse_func_tree(statArrDecl_node->arr_vals[i], state);
-            
-            if (errResult(val)) return val;
-            
-            std::string elem_name = statArrDecl_node->arr_name + std::to_string(i);
+        case _STAT_ARR_DECL_NODE_ : {
+            auto* statArrDecl_node = static_cast<StatArrayDeclNode*>(ptr);
+            int n = statArrDecl_node->arr_size;
             
-            this->func_state.vars[elem_name] = this->func_state.var_counter;
-            this->func_state.var_counter += VAR_STEP;
-        }
+            statArrDecl_node->sym = state->symtab.lookup(statArrDecl_node->arr_name, _SYM_ARR_);
+            if (!statArrDecl_node->sym || statArrDecl_node->sym->arr_ty != _STAT_ || statArrDecl_node->sym->arr_size != n) { 
+                statArrDecl_node->sym = state->symtab.define_arr(statArrDecl_node->arr_name, _STAT_, n);
+            }
         
-        Result* res = traverse_func_tree(statArrDecl_node->next, state);
+            for (int i = n-1; i >= 0; --i) {
+                Result* val = traverse_func_tree(statArrDecl_node->arr_vals[i], state);
+            
+                if (errResult(val)) return val;
+            }
         
-        if (errResult(res)) return res;
-    }
-    else if (dynArrDecl_node) {
-        dynArrDecl_node->arrayDecl_loop = this->func_state.arrayDecl_loop;
-        this->func_state.arrayDecl_loop += 1;
+            Result* res = traverse_func_tree(statArrDecl_node->next, state);
         
-        auto it = this->func_state.arrs.find(dynArrDecl_node->arr_name);
-        if (it == this->func_state.arrs.end()) { this->func_state.arrs[dynArrDecl_node->arr_name] = {this->func_state.var_counter, _DYN_};}
-        this->func_state.var_counter += VAR_STEP;
+            if (errResult(res)) return res;
+            break;
+        }
+        case _DYN_ARR_DECL_NODE_ : {
+            auto* dynArrDecl_node = static_cast<DynArrayDeclNode*>(ptr);
         
-        Result* size = traverse_func_tree(dynArrDecl_node->arr_size, state);
-        Result* val = traverse_func_tree(dynArrDecl_node->arr_val, state);
-        Result* res = traverse_func_tree(dynArrDecl_node->next, state);
+            dynArrDecl_node->sym = state->symtab.lookup(dynArrDecl_node->arr_name, _SYM_ARR_);
+            if (!dynArrDecl_node->sym || dynArrDecl_node->sym->arr_ty != _DYN_) {
+                dynArrDecl_node->sym = state->symtab.define_arr(dynArrDecl_node->arr_name, _DYN_, 0);
+            }
         
-        if (errResult(size)) return size;
-        else if (errResult(val)) return val;
-        else if (errResult(res)) return res;
-    }
-    else if (if_else_node) {
-        int n = if_else_node->conds.size();
+            Result* size = traverse_func_tree(dynArrDecl_node->arr_size, state);
+            Result* val = traverse_func_tree(dynArrDecl_node->arr_val, state);
+            Result* res = traverse_func_tree(dynArrDecl_node->next, state);
         
-        if (n == 1) {
-            if_else_node->if_num = this->func_state.if_counter;
-            if_else_node->main_num = this->func_state.main_counter;
-            if_else_node->cond_num.push_back(this->func_state.cond_counter);
-            
-            this->func_state.if_counter += 1;
-            this->func_state.main_counter += 1;
-            this->func_state.cond_counter += 1;
-            
-            Result* cond = traverse_func_tree(if_else_node->conds[0].first, state);
-            Result* stmts = traverse_func_tree(if_else_node->conds[0].second, state);
-            Result* res = traverse_func_tree(if_else_node->next, state);
-            
-            if (errResult(cond)) return cond;
-            else if (errResult(stmts)) return stmts;
+            if (errResult(size)) return size;
+            else if (errResult(val)) return val;
             else if (errResult(res)) return res;
+            break;
         }
-        else {
-            if_else_node->if_num = this->func_state.if_counter;
-            if_else_node->main_num = this->func_state.main_counter;
-            for (int i = 1; i < n; ++i) {
-                if_else_node->cond_num.push_back(this->func_state.cond_counter + i - 1);
-                Result* cond = traverse_func_tree(if_else_node->conds[i].first, state);
-                
+        case _IF_ELSE_NODE_ : {
+            auto* if_else_node = static_cast<IfElseNode*>(ptr);
+            int n = if_else_node->conds.size();
+        
+            if (n == 1) {
+                Result* cond = traverse_func_tree(if_else_node->conds[0].first, state);
+                Result* stmts = traverse_func_tree(if_else_node->conds[0].second, state);
+                Result* res = traverse_func_tree(if_else_node->next, state);
+            
                 if (errResult(cond)) return cond;
+                else if (errResult(stmts)) return stmts;
+                else if (errResult(res)) return res;
             }
-            if_else_node->cond_num.push_back(this->func_state.cond_counter + n - 1);
-            this->func_state.cond_counter += n;
-            this->func_state.main_counter += n;
+            else {
+                for (int i = 1; i < n; ++i) {
+                    Result* cond = traverse_func_tree(if_else_node->conds[i].first, state);
+                
+                    if (errResult(cond)) return cond;
+                }
+                // conds[0] is the else, or the last else-if when the else is empty
+                if (if_else_node->conds[0].first) {
+                    Result* cond = traverse_func_tree(if_else_node->conds[0].first, state);
+                    
+                    if (errResult(cond)) return cond;
+                }
             
-            for (int i = 1; i < n; ++i) {
-                this->func_state.if_counter += 1;
-                Result* stmts = traverse_func_tree(if_else_node->conds[i].second, state);
+                for (int i = 1; i < n; ++i) {
+                    Result* stmts = traverse_func_tree(if_else_node->conds[i].second, state);
 
+                    if (errResult(stmts)) return stmts;
+                }
+                Result* stmts = traverse_func_tree(if_else_node->conds[0].second, state);
+                Result* res = traverse_func_tree(if_else_node->next, state);
+            
                 if (errResult(stmts)) return stmts;
+                else if (errResult(res)) return res;
             }
-            Result* stmts = traverse_func_tree(if_else_node->conds[0].second, state);
-            Result* res = traverse_func_tree(if_else_node->next, state);
-            
-            if (errResult(stmts)) return stmts;
-            else if (errResult(res)) return res;
+            break;
         }
-    }
-    else if (while_node) {
-        while_node->while_num = this->func_state.loop_counter;
-        while_node->main_num = this->func_state.main_counter;
-        this->func_state.loop_counter += 1;    
-        this->func_state.main_counter += 1;
-        
-        Result* cond = traverse_func_tree(while_node->cond, state);
-        Result* stmts = traverse_func_tree(while_node->stmts, state);
-        Result* res = traverse_func_tree(while_node->next, state);
+        case _WHILE_NODE_ : {
+            auto* while_node = static_cast<WhileNode*>(ptr);
         
-        if (errResult(cond)) return cond;
-        else if (errResult(stmts)) return stmts;
-        else if (errResult(res)) return res;
-    }
-    else if (return_node) {
-        Result* val = traverse_func_tree(return_node->return_val, state);
-        Result* res = traverse_func_tree(return_node->next, state);
+            Result* cond = traverse_func_tree(while_node->cond, state);
+            Result* stmts = traverse_func_tree(while_node->stmts, state);
+            Result* res = traverse_func_tree(while_node->next, state);
         
-        if (errResult(val)) return val;
-        else if (errResult(res)) return res;
-    }
-    else if (funcCall_node) {
-        if (state.funcs.find(funcCall_node->func_name) == state.funcs.end()) {
-            return new Result(ErrType::_ERR_FUNC_EXIST_, funcCall_node->line_index, "Function '" + funcCall_node->func_name + "' not defined!"); 
+            if (errResult(cond)) return cond;
+            else if (errResult(stmts)) return stmts;
+            else if (errResult(res)) return res;
+            break;
         }
+        case _PRINT_NODE_ : {
+            auto* print_node = static_cast<PrintNode*>(ptr);
+            if (!impure_line) { impure_line = print_node->line_index; }
+            Result* val = traverse_func_tree(print_node->print_val, state);
+            Result* res = traverse_func_tree(print_node->next, state);
         
-        for (auto it : funcCall_node->func_args) {
-            Result* tmp = traverse_func_tree(it, state);
-            if (errResult(tmp)) return tmp;
-        }
-    }
-    
-    return new Result(ErrType::_OK_, -1, "");
-};
-
-void FuncDef::print_func_asm(ASTNode* ptr) {
-    auto* num_node = dynamic_cast<NumNode*>(ptr);
-    auto* var_node = dynamic_cast<VarNode*>(ptr);
-    auto* arrElem_node = dynamic_cast<ArrayElemNode*>(ptr);
-    auto* bin_op_node = dynamic_cast<BinaryNode*>(ptr);
-    auto* main_node = dynamic_cast<MainNode*>(ptr);
-    auto* assign_node = dynamic_cast<AssignNode*>(ptr);
-    auto* arrElemAssign_node = dynamic_cast<ArrayElemAssignNode*>(ptr);
-    auto* print_node = dynamic_cast<PrintNode*>(ptr);
-    auto* statArrDecl_node = dynamic_cast<StatArrayDeclNode*>(ptr);
-    auto* dynArrDecl_node = dynamic_cast<DynArrayDeclNode*>(ptr);
-    auto* if_else_node = dynamic_cast<IfElseNode*>(ptr);
-    auto* while_node = dynamic_cast<WhileNode*>(ptr);
-    auto* funcCall_node = dynamic_cast<FuncCall*>(ptr);
-    auto* return_node = dynamic_cast<ReturnNode*>(ptr);
-    
-    if (num_node) {
-        std::cout << "  mov rax, " << num_node->num << std::endl;
-    }
-    else if (var_node) {
-        std::cout << "  mov rax, QWORD PTR [rbp-" << 2 * this->func_state.vars[var_node->var_name] << "]" << std::endl;
-    }
-    else if (arrElem_node) {
-        auto it = this->func_state.arrs.find(arrElem_node->arr_name);
-        if (it != this->func_state.arrs.end()) {
-            ArrayType ty = it->second.second;
-            if (ty == ArrayType::_STAT_) {
-                std::cout << "  lea rdi, [rbp-" << 2*this->func_state.arrs[arrElem_node->arr_name].first-8 << "]" << std::endl;
-                print_func_asm(arrElem_node->elem_index);
-                std::cout << "  mov rsi, rax" << std::endl;
-                std::cout << "  call get" << std::endl;
-            }
-            else if (ty == ArrayType::_DYN_) {
-                std::cout << "  mov rdi, QWORD PTR [rbp-" << 2*this->func_state.arrs[arrElem_node->arr_name].first << "]" << std::endl;
-                print_func_asm(arrElem_node->elem_index);
-                std::cout << "  mov rsi, rax" << std::endl;
-                std::cout << "  call get" << std::endl;
-            }
-        }
-    }
-    else if (funcCall_node) {
-        std::vector<std::string> asm_args = {"rdi", "rsi", "rdx", "rcx"};
-        std::vector<int> call_registers;
-        std::reverse(funcCall_node->func_args.begin(), funcCall_node->func_args.end());
-        int n = (int)funcCall_node->func_args.size();
-        for (int i = 0; i < n; ++i) {
-            print_func_asm(funcCall_node->func_args[i]);
-            
-            auto* it = dynamic_cast<FuncCall*>(funcCall_node->func_args[i]);
-            
-            if (it) {
-                call_registers.push_back(i);
-                std::cout << "  push rax" << std::endl;
-            }
-            else {
-                std::cout << "  mov " << asm_args[i] << ", rax" << std::endl;
-            }
+            if (errResult(val)) return val;
+            else if (errResult(res)) return res;
+            break;
         }
-        std::reverse(call_registers.begin(), call_registers.end());
-        int r = (int)call_registers.size();
-        for (int i = 0; i < r; ++i) {
-            std::cout << "  pop " << asm_args[call_registers[i]] << std::endl;
+        case _SCAN_NODE_ : {
+            auto* scan_node = static_cast<ScanNode*>(ptr);
+            if (!impure_line) { impure_line = scan_node->line_index; }
+            scan_node->sym = state->symtab.lookup(scan_node->var_name, _SYM_VAR_);
+            if (!scan_node->sym)
+                return err_result(ErrType::_ERR_VAR_, scan_node->line_index, "Variable '" + scan_node->var_name + "' not defined!");
+            if (scan_node->sym->var_ty == _CONST_)
+                return err_result(ErrType::_ERR_CONST_, scan_node->line_index, "Can't assign to const '" + scan_node->var_name + "'!!");
+            
+            Result* res = traverse_func_tree(scan_node->next, state);
+            if (errResult(res)) return res;
+            break;
         }
-        std::cout << "  call " + funcCall_node->func_name << std::endl;  
-    }
-    else if (bin_op_node) {
-        switch (bin_op_node->tag) {
-            case _ADD_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  add rax, rbx" << std::endl;
-                break;
-            }
-            case _SUB_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  sub rax, rbx" << std::endl;
-                break;
-            }
-            case _MUL_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  imul rax, rbx" << std::endl;
-                break;
-            }
-            case _DIV_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  mov rax, rbx" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  cqo" << std::endl;
-                std::cout << "  xor rdx, rdx" << std::endl;
-                std::cout << "  idiv rbx" << std::endl;
-                break;
-            }
-            case _MOD_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  mov rax, rbx" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  cqo" << std::endl;
-                std::cout << "  xor rdx, rdx" << std::endl;
-                std::cout << "  idiv rbx" << std::endl;
-                std::cout << "  mov rax, rdx" << std::endl;
-                break;
-            }
-            case _SHL_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  mov rax, rbx" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call shlf" << std::endl;
-                break;
-            }
-            case _SHR_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  mov rax, rbx" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call shrf" << std::endl;
-                break;
-            }
-            case _AND_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  and rax, rbx" << std::endl;
-                break;
-            }
-            case _OR_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  or rax, rbx" << std::endl;
-                break;
-            }
-            case _NOT_ : {
-                print_func_asm(bin_op_node->right);
-                std::cout << "  not rax" << std::endl;
-                break;
-            }
-            case _LESS_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_less" << std::endl;  
-                break;
-            }
-            case _GREAT_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_great" << std::endl; 
-                break;
+        case _ARR_PRINT_NODE_ : {
+            auto* arrPrint_node = static_cast<ArrayPrintNode*>(ptr);
+            if (!impure_line) { impure_line = arrPrint_node->line_index; }
+            arrPrint_node->sym = state->symtab.lookup(arrPrint_node->arr_name, _SYM_ARR_);
+            if (!arrPrint_node->sym) {
+                std::string arr = arrPrint_node->arr_name.substr(1, arrPrint_node->arr_name.length()-2);
+                return err_result(ErrType::_ERR_ARR_, arrPrint_node->line_index, "Unknown array '" + arr + "'!");
             }
-            case _EQ_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_eq" << std::endl; 
-                break;
-            }
-            case _NEQ_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_neq" << std::endl; 
-                break;
-            }
-            case _LEQ_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_leq" << std::endl; 
-                break;
-            }
-            case _GEQ_ : {
-                print_func_asm(bin_op_node->left);
-                std::cout << "  push rax" << std::endl;
-                print_func_asm(bin_op_node->right);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_geq" << std::endl; 
-                break;
-            }
-            case _NEG_ : {
-                print_func_asm(bin_op_node->right);
-                std::cout << "  mov r8, -1" << std::endl;
-                std::cout << "  mul r8" << std::endl;
-                break;
-            }
-            default: break;
-        }
-    }
-    else if (main_node) {
-        std::cout << this->func_name + ":" << std::endl;
-        std::cout << "  push rbp" << std::endl;
-        std::cout << "  mov rbp, rsp" << std::endl;
-        std::cout << "  sub rsp, " << 8*(this->func_state.vars.size() + this->func_state.arrs.size()) << std::endl; 
+            Result* count = traverse_func_tree(arrPrint_node->count, state);
+            Result* res = traverse_func_tree(arrPrint_node->next, state);
         
-        for (int i = 0; i < (int)this->func_args.size(); ++i) {
-            VarNode* jt = dynamic_cast<VarNode*>(this->func_args[i]);
-            std::cout << "  mov QWORD PTR [rbp-" << 2 * this->func_state.vars[jt->var_name]  << "], " << this->asm_args[i] << std::endl;
+            if (errResult(count)) return count;
+            else if (errResult(res)) return res;
+            break;
         }
-        
-        print_func_asm(main_node->next);
-        std::cout << "  leave" << std::endl;
-        std::cout << "  ret\n" << std::endl;
-    }
-    else if (assign_node) {
-        print_func_asm(assign_node->assign_val);
-        std::cout << "  mov QWORD PTR [rbp-" << 2 * this->func_state.vars[assign_node->var_name] << "], rax" << std::endl;
-        print_func_asm(assign_node->next);
-    }
-    else if (arrElemAssign_node) {
-        auto it = this->func_state.arrs.find(arrElemAssign_node->arr_name);
-        if (it != this->func_state.arrs.end()) { 
-            ArrayType ty = it->second.second;
-            if (ty == ArrayType::_STAT_) {
-                std::cout << "  lea rdi, [rbp-" << 2*this->func_state.arrs[arrElemAssign_node->arr_name].first << "]" << std::endl;
-                print_func_asm(arrElemAssign_node->elem_index);
-                std::cout << "  mov rsi, rax" << std::endl;
-                print_func_asm(arrElemAssign_node->assign_val);
-                std::cout << "  mov rdx, rax" << std::endl;
-                std::cout << "  call set" << std::endl;
+        case _ARR_SCAN_NODE_ : {
+            auto* arrScan_node = static_cast<ArrayScanNode*>(ptr);
+            if (!impure_line) { impure_line = arrScan_node->line_index; }
+            arrScan_node->sym = state->symtab.lookup(arrScan_node->arr_name, _SYM_ARR_);
+            if (!arrScan_node->sym) {
+                std::string arr = arrScan_node->arr_name.substr(1, arrScan_node->arr_name.length()-2);
+                return err_result(ErrType::_ERR_ARR_, arrScan_node->line_index, "Unknown array '" + arr + "'!");
             }
-            else if (ty == ArrayType::_DYN_) {
-                std::cout << "  mov rdi, QWORD PTR [rbp-" << 2*this->func_state.arrs[arrElemAssign_node->arr_name].first << "]" << std::endl;
-                print_func_asm(arrElemAssign_node->elem_index);
-                std::cout << "  mov rsi, rax" << std::endl;
-                print_func_asm(arrElemAssign_node->assign_val);
-                std::cout << "  mov rdx, rax" << std::endl;
-                std::cout << "  call set" << std::endl;
-            }
-            else { return; }
-        }
-        
-        print_func_asm(arrElemAssign_node->next);
-    }
-    else if (print_node) {
-        print_func_asm(print_node->print_val);
-        std::cout << "  lea rdi, print_format" << std::endl;
-        std::cout << "  mov rsi, rax" << std::endl;
-        std::cout << "  xor rax, rax" << std::endl;
-        std::cout << "  call printf" << std::endl;
-        print_func_asm(print_node->next);
-    }
-    else if (statArrDecl_node) {
-        for (int i = 0; i < statArrDecl_node->arr_size; ++i) {
-            print_func_asm(statArrDecl_node->arr_vals[i]);
-            
-            std::string elem_name = statArrDecl_node->arr_name + std::to_string(i);
-            std::cout << "  mov QWORD PTR [rbp-" << 2 * this->func_state.vars[elem_name] << "], rax" << std::endl;
-        }
+            Result* count = traverse_func_tree(arrScan_node->count, state);
+            Result* res = traverse_func_tree(arrScan_node->next, state);
         
-        print_func_asm(statArrDecl_node->next);
-    }
-    else if (dynArrDecl_node) {
-        int num = num_vars(dynArrDecl_node->arr_size, 0);
-        if (num == 0) {
-            int res = num_expr_eval(dynArrDecl_node->arr_size, 0);
-            std::cout << "  mov rax, " << std::to_string(res) << std::endl;
-        }
-        else {
-            print_func_asm(dynArrDecl_node->arr_size);
+            if (errResult(count)) return count;
+            else if (errResult(res)) return res;
+            break;
         }
-        std::cout << "  mov rdi, rax" << std::endl;
-        print_func_asm(dynArrDecl_node->arr_val);
-        std::cout << "  mov rsi, rax" << std::endl;
-        std::cout << "  call dyn_malloc" << std::endl;
-        
-        std::cout << "  mov QWORD PTR [rbp-" << 2*this->func_state.arrs[dynArrDecl_node->arr_name].first << "], rax" << std::endl;
-            
-        print_func_asm(dynArrDecl_node->next);
-    }
-    else if (if_else_node) {
-        auto* next_if_else = dynamic_cast<IfElseNode*>(if_else_node->next);
-        auto* next_while = dynamic_cast<WhileNode*>(if_else_node->next);
-        int n = if_else_node->conds.size();
+        case _RETURN_NODE_ : {
+            auto* return_node = static_cast<ReturnNode*>(ptr);
+            Result* val = traverse_func_tree(return_node->return_val, state);
+            Result* res = traverse_func_tree(return_node->next, state);
         
-        if (n == 1) {
-            std::cout << this->func_name << "_if" << if_else_node->if_num << ":" << std::endl;
-            print_func_asm(if_else_node->conds[0].first);
-            std::cout << "  cmp rax, 1" << std::endl;
-            std::cout << "  je " << this->func_name << "_cond" << if_else_node->cond_num[0] << std::endl;
-            
-            if (next_if_else) {
-                std::cout << "  jmp " << this->func_name << "_if" << next_if_else->if_num << std::endl;
-            }
-            else if (next_while) {
-                std::cout << "  jmp " << this->func_name << "_loop" << next_while->while_num << std::endl;
-            }
-            else {
-                std::cout << "  jmp " << this->func_name << "_main" << if_else_node->main_num << std::endl;
-            }
-            
-            std::cout << this->func_name << "_cond" << if_else_node->cond_num[0] << ":" << std::endl;
-            print_func_asm(if_else_node->conds[0].second);
-                
-            if (next_if_else) {
-                std::cout << "  jmp " << this->func_name << "_if" << next_if_else->if_num << std::endl; 
-            }
-            else if (next_while) {
-                std::cout << "  jmp " << this->func_name << "_loop" << next_while->while_num << std::endl;
-            }
-            else {
-                std::cout << "  jmp " << this->func_name << "_main" << if_else_node->main_num << std::endl;
-            }
-            
-            if (!(next_if_else || next_while)) {
-                std::cout << this->func_name << "_main" << if_else_node->main_num << ":" << std::endl;
-            }
-            
-            print_func_asm(if_else_node->next);
+            if (errResult(val)) return val;
+            else if (errResult(res)) return res;
+            break;
         }
-        else {
-            std::cout << this->func_name << "_if" << if_else_node->if_num << ":" << std::endl;
-            int i;
-            for (i = 1; i < n; ++i) {
-                print_func_asm(if_else_node->conds[i].first);
-                std::cout << "  cmp rax, 1" << std::endl;
-                std::cout << "  je " << this->func_name << "_cond" << if_else_node->cond_num[i-1] << std::endl;
-            }
-            std::cout << "  jmp " << this->func_name << "_cond" << if_else_node->cond_num[i-1] << std::endl;
-            
-            for (i = 1; i < n; ++i) {
-                std::cout << this->func_name << "_cond" << if_else_node->cond_num[i-1] << ":" << std::endl;
-                print_func_asm(if_else_node->conds[i].second);
-                
-                if (next_if_else) {
-                    std::cout << "  jmp " << this->func_name << "_if" << next_if_else->if_num << std::endl; 
-                }
-                else if (next_while) {
-                    std::cout << "  jmp " << this->func_name << "_loop" << next_while->while_num << std::endl;
-                }
-                else {
-                    std::cout << "  jmp " << this->func_name << "_main" << if_else_node->main_num << std::endl;
-                }
-            }
-            std::cout << this->func_name << "_cond" << if_else_node->cond_num[i-1] << ":" << std::endl;
-            print_func_asm(if_else_node->conds[0].second);
-                
-            if (next_if_else) {
-                std::cout << "  jmp " << this->func_name << "_if" << next_if_else->if_num << std::endl; 
-            }
-            else if (next_while) {
-                std::cout << "  jmp " << this->func_name << "_loop" << next_while->while_num << std::endl;
+        case _FUNC_CALL_NODE_ : {
+            auto* funcCall_node = static_cast<FuncCall*>(ptr);
+            Symbol* callee = state->symtab.lookup(funcCall_node->func_name, _SYM_FUNC_);
+            if (!callee) {
+                return err_result(ErrType::_ERR_FUNC_EXIST_, funcCall_node->line_index, "Function '" + funcCall_node->func_name + "' not defined!"); 
             }
-            else {
-                std::cout << "  jmp " << this->func_name << "_main" << if_else_node->main_num << std::endl;
-                std::cout << this->func_name << "_main" << if_else_node->main_num << ":" << std::endl;
-            }
-            print_func_asm(if_else_node->next);
-        }
-        
-    }
-    else if (while_node) {
-        auto* next_while = dynamic_cast<WhileNode*>(while_node->next);
-        auto* next_if_else = dynamic_cast<IfElseNode*>(while_node->next);
-        
-        std::cout << this->func_name << "_loop" << while_node->while_num << ":" << std::endl;
-        print_func_asm(while_node->cond);
-        std::cout << "  cmp rax, 0" << std::endl;
-        if (next_while) {
-            std::cout << "  je " << this->func_name << "_loop" << next_while->while_num << std::endl;
-        }
-        else if (next_if_else) {
-            std::cout << "  je " << this->func_name << "_if" << next_if_else->if_num << std::endl;
-        }
-        else {
-            std::cout << "  je " << this->func_name << "_main" << while_node->main_num << std::endl;
-        }
-        print_func_asm(while_node->stmts);
-        std::cout << "  jmp " << this->func_name << "_loop" << while_node->while_num << std::endl;
+            // calls to itself are still being checked and count as pure
+            auto* callee_def = node_cast<FuncDef>(callee->func_node);
+            if (callee_def && callee_def->impure_line && !impure_line) { impure_line = funcCall_node->line_index; }
         
-        if (!(next_while || next_if_else)) {
-            std::cout << this->func_name << "_main" << while_node->main_num << ":" << std::endl;
+            for (auto it : funcCall_node->func_args) {
+                Result* tmp = traverse_func_tree(it, state);
+                if (errResult(tmp)) return tmp;
+            }
+            break;
         }
-        print_func_asm(while_node->next);
-    }
-    else if (return_node) {
-        print_func_asm(return_node->return_val);
+        default : break;
     }
+    
+    return ok_result();
 };
 
 Result* traverse_tree(ASTNode* ptr, ProgState* state) {
-    auto* num_node = dynamic_cast<NumNode*>(ptr);
-    auto* var_node = dynamic_cast<VarNode*>(ptr);
-    auto* arrElem_node = dynamic_cast<ArrayElemNode*>(ptr);
-    auto* bin_op_node = dynamic_cast<BinaryNode*>(ptr);
-    auto* main_node = dynamic_cast<MainNode*>(ptr);
-    auto* assign_node = dynamic_cast<AssignNode*>(ptr);
-    auto* print_node = dynamic_cast<PrintNode*>(ptr);
-    auto* scan_node = dynamic_cast<ScanNode*>(ptr);
-    auto* statArrDecl_node = dynamic_cast<StatArrayDeclNode*>(ptr);
-    auto* dynArrDecl_node = dynamic_cast<DynArrayDeclNode*>(ptr);
-    auto* arrElemAssign_node = dynamic_cast<ArrayElemAssignNode*>(ptr);
-    auto* if_else_node = dynamic_cast<IfElseNode*>(ptr);
-    auto* while_node = dynamic_cast<WhileNode*>(ptr);
-    auto* funcDef_node = dynamic_cast<FuncDef*>(ptr);
-    auto* funcCall_node = dynamic_cast<FuncCall*>(ptr);
+    if (!ptr) { return ok_result(); }
     
-    if (num_node) { return new Result(ErrType::_OK_, -1, ""); }
-    else if (var_node) { 
-        if (state->vars.find(var_node->var_name) == state->vars.end()) {
-            return new Result(ErrType::_ERR_VAR_, var_node->line_index, "Variable '" + var_node->var_name + "' not defined!");
-        }
-    }
-    else if (arrElem_node) {
-        if (state->arrs.find(arrElem_node->arr_name) == state->arrs.end()) {
-            std::string arr = arrElem_node->arr_name.substr(1, arrElem_node->arr_name.length()-2);
-            return new Result(ErrType::_ERR_ARR_, arrElem_node->line_index, "Unknown array '" + arr + "'!");
-        }
-        else {
-            Result* index = traverse_tree(arrElem_node->elem_index, state);
-            if (errResult(index)) return index;
+    switch (ptr->kind) {
+        case _NUM_NODE_ : { return ok_result(); }
+        case _VAR_NODE_ : {
+            auto* var_node = static_cast<VarNode*>(ptr);
+            var_node->sym = state->symtab.lookup(var_node->var_name, _SYM_VAR_);
+            if (!var_node->sym) {
+                return err_result(ErrType::_ERR_VAR_, var_node->line_index, "Variable '" + var_node->var_name + "' not defined!");
+            }
+            break;
         }
-    }
-    else if (bin_op_node) {
-        Result* lhs = traverse_tree(bin_op_node->left, state);
-        Result* rhs = traverse_tree(bin_op_node->right, state);
-        
-        if (errResult(lhs)) return lhs;
-        else if (errResult(rhs)) return rhs;
-    }
-    else if (main_node) {
-        Result* res = traverse_tree(main_node->next, state);
-        if (errResult(res)) return res;
-    }
-    else if (assign_node) {
-        Result* val = traverse_tree(assign_node->assign_val, state);
-        if (errResult(val)) return val;
-        
-        auto it = state->vars.find(assign_node->var_name);
-        switch (assign_node->assign_ty) {
-            case VarType::_VAR_ : {
-                if (it == state->vars.end()) {
-                    state->vars[assign_node->var_name] = state->var_counter;
-                    state->var_counter += VAR_STEP;
-                } 
-                break;
+        case _ARR_ELEM_NODE_ : {
+            auto* arrElem_node = static_cast<ArrayElemNode*>(ptr);
+            arrElem_node->sym = state->symtab.lookup(arrElem_node->arr_name, _SYM_ARR_);
+            if (!arrElem_node->sym) {
+                std::string arr = arrElem_node->arr_name.substr(1, arrElem_node->arr_name.length()-2);
+                return err_result(ErrType::_ERR_ARR_, arrElem_node->line_index, "Unknown array '" + arr + "'!");
             }
-            case VarType::_CONST_ : {
-                if (it == state->vars.end()) {
-                    state->vars[assign_node->var_name] = state->var_counter;
-                    state->var_counter += VAR_STEP;
-                }
-                else {
-                    return new Result(ErrType::_ERR_CONST_, assign_node->line_index, "Can't redefine const '" + assign_node->var_name + "'!!");
-                }
-                break;
+            else {
+                Result* index = traverse_tree(arrElem_node->elem_index, state);
+                if (errResult(index)) return index;
             }
-            default : {break;}
-        }
-        Result* res = traverse_tree(assign_node->next, state);
-        if (errResult(res)) return res;
-    }
-    else if (arrElemAssign_node) {
-        if (state->arrs.find(arrElemAssign_node->arr_name) == state->arrs.end()) {
-            std::string arr = arrElemAssign_node->arr_name.substr(1, arrElemAssign_node->arr_name.length()-2);
-            return new Result(ErrType::_ERR_ARR_, arrElemAssign_node->line_index, "Unknown array '" + arr + "'!");
-        }
-        else {
-            Result* index = traverse_tree(arrElemAssign_node->elem_index, state);
-            Result* val = traverse_tree(arrElemAssign_node->assign_val, state);
-            Result* res = traverse_tree(arrElemAssign_node->next, state);
-            
-            if (errResult(index)) return index;
-            else if (errResult(val)) return val;
-            else if (errResult(res)) return res;
+            break;
         }
-    }
-    else if (print_node) {
-        Result* val = traverse_tree(print_node->print_val, state);
-        Result* res = traverse_tree(print_node->next, state);
-        
-        if (errResult(val)) return val;
-        else if (errResult(res)) return res;
-    }
-    else if (scan_node) {
-        if (state->vars.find(scan_node->var_name) == state->vars.end())
-            return new Result(ErrType::_ERR_VAR_, scan_node->line_index, "Variable '" + scan_node->var_name + "' not defined!");
+        case _BIN_OP_NODE_ : {
+            auto* bin_op_node = static_cast<BinaryNode*>(ptr);
+            Result* lhs = traverse_tree(bin_op_node->left, state);
+            Result* rhs = traverse_tree(bin_op_node->right, state);
         
-        Result* res = traverse_tree(scan_node->next, state);
-        if (errResult(res)) return res;
-    }
-    else if (statArrDecl_node) { 
-        auto it = state->arrs.find(statArrDecl_node->arr_name);
-        if (it == state->arrs.end()) { 
-            state->arrs[statArrDecl_node->arr_name] = {
-                state->var_counter + statArrDecl_node->arr_size*4, 
-                _STAT_
-            }; 
+            if (errResult(lhs)) return lhs;
+            else if (errResult(rhs)) return rhs;
+            break;
         }
-        
-        int n = statArrDecl_node->arr_size;
-        for (int i = n-1; i >= 0; --i) {
-            Result* val = traverse_tree(statArrDecl_node->arr_vals[i], state);
+        case _MAIN_NODE_ : {
+            auto* main_node = static_cast<MainNode*>(ptr);
+            state->symtab.push_scope(true);
             
-            if (errResult(val)) return val;
-            
-            std::string elem_name = statArrDecl_node->arr_name + std::to_string(i);
+            Result* res = traverse_tree(main_node->next, state);
+            state->symtab.pop_scope();
             
-            state->vars[elem_name] = state->var_counter;
-            state->var_counter += VAR_STEP;
+            if (errResult(res)) return res;
+            break;
         }
+        case _ASSIGN_NODE_ : {
+            auto* assign_node = static_cast<AssignNode*>(ptr);
+            Result* val = traverse_tree(assign_node->assign_val, state);
+            if (errResult(val)) return val;
         
-        Result* res = traverse_tree(statArrDecl_node->next, state);
-        
-        if (errResult(res)) return res;
-    }
-    else if (dynArrDecl_node) {
-        dynArrDecl_node->arrayDecl_loop = state->arrayDecl_loop;
-        state->arrayDecl_loop += 1;
-        
-        auto it = state->arrs.find(dynArrDecl_node->arr_name);
-        if (it == state->arrs.end()) { state->arrs[dynArrDecl_node->arr_name] = {state->var_counter, _DYN_};}
-        state->var_counter += VAR_STEP;
-        
-        Result* size = traverse_tree(dynArrDecl_node->arr_size, state);
-        Result* val = traverse_tree(dynArrDecl_node->arr_val, state);
-        Result* res = traverse_tree(dynArrDecl_node->next, state);
-        
-        if (errResult(size)) return size;
-        else if (errResult(val)) return val;
-        else if (errResult(res)) return res;
-    }
-    else if (if_else_node) {
-        int n = if_else_node->conds.size();
-        
-        if (n == 1) {
-            if_else_node->if_num = state->if_counter;
-            if_else_node->main_num = state->main_counter;
-            if_else_node->cond_num.push_back(state->cond_counter);
-            
-            state->if_counter += 1;
-            state->main_counter += 1;
-            state->cond_counter += 1;
-            
-            Result* cond = traverse_tree(if_else_node->conds[0].first, state);
-            Result* stmts = traverse_tree(if_else_node->conds[0].second, state);
-            Result* res = traverse_tree(if_else_node->next, state);
-            
-            if (errResult(cond)) return cond;
-            else if (errResult(stmts)) return stmts;
-            else if (errResult(res)) return res;
+            assign_node->sym = state->symtab.lookup(assign_node->var_name, _SYM_VAR_);
+            switch (assign_node->assign_ty) {
+                case VarType::_VAR_ : {
+                    if (!assign_node->sym) {
+                        assign_node->sym = state->symtab.define_var(assign_node->var_name, _VAR_);
+                    } 
+                    else if (assign_node->sym->var_ty == _CONST_) {
+                        return err_result(ErrType::_ERR_CONST_, assign_node->line_index, "Can't assign to const '" + assign_node->var_name + "'!!");
+                    }
+                    break;
+                }
+                case VarType::_CONST_ : {
+                    if (!assign_node->sym) {
+                        assign_node->sym = state->symtab.define_var(assign_node->var_name, _CONST_);
+                    }
+                    else {
+                        return err_result(ErrType::_ERR_CONST_, assign_node->line_index, "Can't redefine const '" + assign_node->var_name + "'!!");
+                    }
+                    break;
+                }
+                default : {break;}
+            }
+            Result* res = traverse_tree(assign_node->next, state);
+            if (errResult(res)) return res;
+            break;
         }
-        else {
-            if_else_node->if_num = state->if_counter;
-            if_else_node->main_num = state->main_counter;
-            for (int i = 1; i < n; ++i) {
-                if_else_node->cond_num.push_back(state->cond_counter + i - 1);
-                Result* cond = traverse_tree(if_else_node->conds[i].first, state);
-                
-                if (errResult(cond)) return cond;
+        case _ARR_ELEM_ASSIGN_NODE_ : {
+            auto* arrElemAssign_node = static_cast<ArrayElemAssignNode*>(ptr);
+            arrElemAssign_node->sym = state->symtab.lookup(arrElemAssign_node->arr_name, _SYM_ARR_);
+            if (!arrElemAssign_node->sym) {
+                std::string arr = arrElemAssign_node->arr_name.substr(1, arrElemAssign_node->arr_name.length()-2);
+                return err_result(ErrType::_ERR_ARR_, arrElemAssign_node->line_index, "Unknown array '" + arr + "'!");
             }
-            if_else_node->cond_num.push_back(state->cond_counter + n - 1);
-            state->cond_counter += n;
-            state->main_counter += n;
+            else {
+                Result* index = traverse_tree(arrElemAssign_node->elem_index, state);
+                Result* val = traverse_tree(arrElemAssign_node->assign_val, state);
+                Result* res = traverse_tree(arrElemAssign_node->next, state);
             
-            for (int i = 1; i < n; ++i) {
-                state->if_counter += 1;
-                Result* stmts = traverse_tree(if_else_node->conds[i].second, state);
-                
-                if (errResult(stmts)) return stmts;
+                if (errResult(index)) return index;
+                else if (errResult(val)) return val;
+                else if (errResult(res)) return res;
             }
-            Result* stmts = traverse_tree(if_else_node->conds[0].second, state);
-            Result* res = traverse_tree(if_else_node->next, state);
-            
-            if (errResult(stmts)) return stmts;
-            else if (errResult(res)) return res;
+            break;
         }
-    }
-    else if (while_node) {
-        while_node->while_num = state->loop_counter;
-        while_node->main_num = state->main_counter;
-        state->loop_counter += 1;    
-        state->main_counter += 1;
+        case _PRINT_NODE_ : {
+            auto* print_node = static_cast<PrintNode*>(ptr);
+            Result* val = traverse_tree(print_node->print_val, state);
+            Result* res = traverse_tree(print_node->next, state);
         
-        Result* cond = traverse_tree(while_node->cond, state);
-        Result* stmts = traverse_tree(while_node->stmts, state);
-        Result* res = traverse_tree(while_node->next, state);
-        
-        if (errResult(cond)) return cond;
-        else if (errResult(stmts)) return stmts;
-        else if (errResult(res)) return res;
-    }
-    else if (funcDef_node) {
-        for (auto it : funcDef_node->func_args) {
-            auto* jt = dynamic_cast<VarNode*>(it);
-            if (jt) {
-                funcDef_node->func_state.vars[jt->var_name] = funcDef_node->func_state.var_counter;
-                funcDef_node->func_state.var_counter += VAR_STEP;
-            }
+            if (errResult(val)) return val;
+            else if (errResult(res)) return res;
+            break;
         }
+        case _SCAN_NODE_ : {
+            auto* scan_node = static_cast<ScanNode*>(ptr);
+            scan_node->sym = state->symtab.lookup(scan_node->var_name, _SYM_VAR_);
+            if (!scan_node->sym)
+                return err_result(ErrType::_ERR_VAR_, scan_node->line_index, "Variable '" + scan_node->var_name + "' not defined!");
+            if (scan_node->sym->var_ty == _CONST_)
+                return err_result(ErrType::_ERR_CONST_, scan_node->line_index, "Can't assign to const '" + scan_node->var_name + "'!!");
         
-        state->funcs[funcDef_node->func_name] = funcDef_node;
-        Result* func_res = funcDef_node->traverse_func_tree(funcDef_node->func_stmts, *state);
-        
-        if (errResult(func_res)) return func_res;
-        
-        Result* res = traverse_tree(funcDef_node->next, state);
-        if (errResult(res)) return res;
-    }
-    else if (funcCall_node) {
-        auto name = state->funcs.find(funcCall_node->func_name);
-        
-        if (name == state->funcs.end()) {
-            return new Result(ErrType::_ERR_FUNC_EXIST_, funcCall_node->line_index, "Function '" + funcCall_node->func_name + "' not defined!");
+            Result* res = traverse_tree(scan_node->next, state);
+            if (errResult(res)) return res;
+            break;
         }
+        case _ARR_PRINT_NODE_ : {
+            auto* arrPrint_node = static_cast<ArrayPrintNode*>(ptr);
+            arrPrint_node->sym = state->symtab.lookup(arrPrint_node->arr_name, _SYM_ARR_);
+            if (!arrPrint_node->sym) {
+                std::string arr = arrPrint_node->arr_name.substr(1, arrPrint_node->arr_name.length()-2);
+                return err_result(ErrType::_ERR_ARR_, arrPrint_node->line_index, "Unknown array '" + arr + "'!");
+            }
+            Result* count = traverse_tree(arrPrint_node->count, state);
+            Result* res = traverse_tree(arrPrint_node->next, state);
         
-        for (auto it : funcCall_node->func_args) {
-            Result* tmp = traverse_tree(it, state);
-            if (errResult(tmp)) return tmp;
+            if (errResult(count)) return count;
+            else if (errResult(res)) return res;
+            break;
         }
-    }
-    
-    return new Result(ErrType::_OK_, -1, "");
-};
-
-void print_asm(ASTNode* ptr, ProgState state) {
-    auto* num_node = dynamic_cast<NumNode*>(ptr);
-    auto* var_node = dynamic_cast<VarNode*>(ptr);
-    auto* arrElem_node = dynamic_cast<ArrayElemNode*>(ptr);
-    auto* bin_op_node = dynamic_cast<BinaryNode*>(ptr);
-    auto* main_node = dynamic_cast<MainNode*>(ptr);
-    auto* assign_node = dynamic_cast<AssignNode*>(ptr);
-    auto* print_node = dynamic_cast<PrintNode*>(ptr);
-    auto* scan_node = dynamic_cast<ScanNode*>(ptr);
-    auto* statArrDecl_node = dynamic_cast<StatArrayDeclNode*>(ptr);
-    auto* dynArrDecl_node = dynamic_cast<DynArrayDeclNode*>(ptr);
-    auto* arrElemAssign_node = dynamic_cast<ArrayElemAssignNode*>(ptr);
-    auto* if_else_node = dynamic_cast<IfElseNode*>(ptr);
-    auto* while_node = dynamic_cast<WhileNode*>(ptr);
-    auto* funcDef_node = dynamic_cast<FuncDef*>(ptr);
-    auto* funcCall_node = dynamic_cast<FuncCall*>(ptr);
-    
-    if (num_node) {
-        std::cout << "  mov rax, " << num_node->num << std::endl;
-    }
-    else if (var_node) {
-        std::cout << "  mov rax, QWORD PTR [rbp-" << 2 * state.vars[var_node->var_name] << "]" << std::endl;
-    }
-    else if (arrElem_node) {
-        auto it = state.arrs.find(arrElem_node->arr_name);
-        if (it != state.arrs.end()) {
-            ArrayType ty = it->second.second;
-            if (ty == ArrayType::_STAT_) {
-                std::cout << "  lea rdi, [rbp-" << 2*state.arrs[arrElem_node->arr_name].first-8 << "]" << std::endl;
-                print_asm(arrElem_node->elem_index, state);
-                std::cout << "  mov rsi, rax" << std::endl;
-                std::cout << "  call get" << std::endl;
-            }
-            else if (ty == ArrayType::_DYN_) {
-                std::cout << "  mov rdi, QWORD PTR [rbp-" << 2*state.arrs[arrElem_node->arr_name].first << "]" << std::endl;
-                print_asm(arrElem_node->elem_index, state);
-                std::cout << "  mov rsi, rax" << std::endl;
-                std::cout << "  call get" << std::endl;
+        case _ARR_SCAN_NODE_ : {
+            auto* arrScan_node = static_cast<ArrayScanNode*>(ptr);
+            arrScan_node->sym = state->symtab.lookup(arrScan_node->arr_name, _SYM_ARR_);
+            if (!arrScan_node->sym) {
+                std::string arr = arrScan_node->arr_name.substr(1, arrScan_node->arr_name.length()-2);
+                return err_result(ErrType::_ERR_ARR_, arrScan_node->line_index, "Unknown array '" + arr + "'!");
             }
+            Result* count = traverse_tree(arrScan_node->count, state);
+            Result* res = traverse_tree(arrScan_node->next, state);
+        
+            if (errResult(count)) return count;
+            else if (errResult(res)) return res;
+            break;
         }
-    }
-    else if (funcCall_node) {
-        std::vector<std::string> asm_args = {"rdi", "rsi", "rdx", "rcx"};
-        std::vector<int> call_registers;
-        std::reverse(funcCall_node->func_args.begin(), funcCall_node->func_args.end());
-        int n = (int)funcCall_node->func_args.size();
-        for (int i = 0; i < n; ++i) {
-            print_asm(funcCall_node->func_args[i], state);
-            
-            auto* it = dynamic_cast<FuncCall*>(funcCall_node->func_args[i]);
+        case _STAT_ARR_DECL_NODE_ : {
+            auto* statArrDecl_node = static_cast<StatArrayDeclNode*>(ptr);
+            int n = statArrDecl_node->arr_size;
             
-            if (it) {
-                call_registers.push_back(i);
-                std::cout << "  push rax" << std::endl;
-            }
-            else {
-                std::cout << "  mov " << asm_args[i] << ", rax" << std::endl;
-            }
-        }
-        std::reverse(call_registers.begin(), call_registers.end());
-        int r = (int)call_registers.size();
-        for (int i = 0; i < r; ++i) {
-            std::cout << "  pop " << asm_args[call_registers[i]] << std::endl;
-        }
-        std::cout << "  call " + funcCall_node->func_name << std::endl;  
-    }
-    else if (bin_op_node) {
-        switch (bin_op_node->tag) {
-            case _ADD_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  add rax, rbx" << std::endl;
-                break;
-            }
-            case _SUB_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  sub rax, rbx" << std::endl;
-                break;
-            }
-            case _MUL_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  imul rax, rbx" << std::endl;
-                break;
-            }
-            case _DIV_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  mov rax, rbx" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  cqo" << std::endl;
-                std::cout << "  xor rdx, rdx" << std::endl;
-                std::cout << "  idiv rbx" << std::endl;
-                break;
-            }
-            case _MOD_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  mov rax, rbx" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  cqo" << std::endl;
-                std::cout << "  xor rdx, rdx" << std::endl;
-                std::cout << "  idiv rbx" << std::endl;
-                std::cout << "  mov rax, rdx" << std::endl;
-                break;
-            }
-            case _SHL_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  mov rax, rbx" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call shlf" << std::endl;
-                break;
-            }
-            case _SHR_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  mov rax, rbx" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call shrf" << std::endl;
-                break;
-            }
-            case _AND_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  and rax, rbx" << std::endl;
-                break;
-            }
-            case _OR_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  or rax, rbx" << std::endl;
-                break;
-            }
-            case _NOT_ : {
-                print_asm(bin_op_node->right, state);
-                std::cout << "  not rax" << std::endl;
-                break;
-            }
-            case _LESS_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_less" << std::endl;  
-                break;
-            }
-            case _GREAT_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_great" << std::endl; 
-                break;
-            }
-            case _EQ_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_eq" << std::endl; 
-                break;
-            }
-            case _NEQ_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_neq" << std::endl; 
-                break;
-            }
-            case _LEQ_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_leq" << std::endl; 
-                break;
-            }
-            case _GEQ_ : {
-                print_asm(bin_op_node->left, state);
-                std::cout << "  push rax" << std::endl;
-                print_asm(bin_op_node->right, state);
-                std::cout << "  push rax" << std::endl;
-                std::cout << "  pop rbx" << std::endl;
-                std::cout << "  pop rax" << std::endl;
-                std::cout << "  mov rdi, rax" << std::endl;
-                std::cout << "  mov rsi, rbx" << std::endl;
-                std::cout << "  call cmp_geq" << std::endl; 
-                break;
+            statArrDecl_node->sym = state->symtab.lookup(statArrDecl_node->arr_name, _SYM_ARR_);
+            if (!statArrDecl_node->sym || statArrDecl_node->sym->arr_ty != _STAT_ || statArrDecl_node->sym->arr_size != n) { 
+                statArrDecl_node->sym = state->symtab.define_arr(statArrDecl_node->arr_name, _STAT_, n);
             }
-            case _NEG_ : {
-                print_asm(bin_op_node->right, state);
-                std::cout << "  mov r8, -1" << std::endl;
-                std::cout << "  mul r8" << std::endl;
-                break;
-            }
-            default: break;
-        }
-    }
-    else if (main_node) {
-        std::cout << ".intel_syntax noprefix\n" << std::endl;
-
-        std::cout << ".data" << std::endl;
-        std::cout << "  print_format: .asciz \"\%ld\\n\"" << std::endl;
-        std::cout << "  scan_format: .asciz \"\%ld\"" << std::endl;
-        
-        std::cout << "\n.text\n" << std::endl;
-        std::cout << ".global main" << std::endl;
         
-        for (auto it : state.funcs) {
-            auto* jt = dynamic_cast<FuncDef*>(it.second);
-            if (jt) { jt->print_func_asm(jt->func_stmts); }
-        }
+            for (int i = n-1; i >= 0; --i) {
+                Result* val = traverse_tree(statArrDecl_node->arr_vals[i], state);
+            
+                if (errResult(val)) return val;
+            }
         
-        std::cout << "main:" << std::endl;
-        std::cout << "  push rbp" << std::endl;
-        std::cout << "  mov rbp, rsp" << std::endl;
+            Result* res = traverse_tree(statArrDecl_node->next, state);
         
-        int scans = 0;
-        num_of_scans(main_node, &scans);
-        scans *= 16;
-        int vars = 0;
-        for (auto it : state.vars) {
-            if (vars < it.second) { vars = it.second; }
-        }
-        for (auto it : state.arrs) {
-            if (vars < it.second.first) { vars = it.second.first; }
+            if (errResult(res)) return res;
+            break;
         }
-        vars *= 2;
+        case _DYN_ARR_DECL_NODE_ : {
+            auto* dynArrDecl_node = static_cast<DynArrayDeclNode*>(ptr);
         
-        if (scans >= vars) {
-            std::cout << "  sub rsp, " << scans << std::endl;
-        }
-        else {
-            std::cout << "  sub rsp, " << get_size(vars) << std::endl;
-        }
-
-        print_asm(main_node->next, state);
-        std::cout << "  leave" << std::endl;
-        std::cout << "  ret\n" << std::endl;
-    }
-    else if (assign_node) {
-        print_asm(assign_node->assign_val, state);
-        std::cout << "  mov QWORD PTR [rbp-" << 2 * state.vars[assign_node->var_name] << "], rax" << std::endl;
-        print_asm(assign_node->next, state);
-    }
-    else if (arrElemAssign_node) {
-        auto it = state.arrs.find(arrElemAssign_node->arr_name);
-        if (it != state.arrs.end()) { 
-            ArrayType ty = it->second.second;
-            if (ty == ArrayType::_STAT_) {
-                std::cout << "  lea rdi, [rbp-" << 2*state.arrs[arrElemAssign_node->arr_name].first << "]" << std::endl;
-                print_asm(arrElemAssign_node->elem_index, state);
-                std::cout << "  mov rsi, rax" << std::endl;
-                print_asm(arrElemAssign_node->assign_val, state);
-                std::cout << "  mov rdx, rax" << std::endl;
-                std::cout << "  call set" << std::endl;
+            dynArrDecl_node->sym = state->symtab.lookup(dynArrDecl_node->arr_name, _SYM_ARR_);
+            if (!dynArrDecl_node->sym || dynArrDecl_node->sym->arr_ty != _DYN_) {
+                dynArrDecl_node->sym = state->symtab.define_arr(dynArrDecl_node->arr_name, _DYN_, 0);
             }
-            else if (ty == ArrayType::_DYN_) {
-                std::cout << "  mov rdi, QWORD PTR [rbp-" << 2*state.arrs[arrElemAssign_node->arr_name].first << "]" << std::endl;
-                print_asm(arrElemAssign_node->elem_index, state);
-                std::cout << "  mov rsi, rax" << std::endl;
-                print_asm(arrElemAssign_node->assign_val, state);
-                std::cout << "  mov rdx, rax" << std::endl;
-                std::cout << "  call set" << std::endl;
-            }
-            else { return; }
-        }
         
-        print_asm(arrElemAssign_node->next, state);
-    }
-    else if (print_node) {
-        print_asm(print_node->print_val, state);
-        std::cout << "  lea rdi, print_format" << std::endl;
-        std::cout << "  mov rsi, rax" << std::endl;
-        std::cout << "  xor rax, rax" << std::endl;
-        std::cout << "  call printf" << std::endl;
-        print_asm(print_node->next, state);
-    }
-    else if (scan_node) {
-        std::cout << "  lea rdi, scan_format" << std::endl;
-        std::cout << "  lea rsi, [rbp-" << 2 * state.vars[scan_node->var_name] << "]" << std::endl;
-        std::cout << "  xor rax, rax" << std::endl;
-        std::cout << "  call scanf" << std::endl;
-        print_asm(scan_node->next, state);
-    }
-    else if (statArrDecl_node) {
-        for (int i = 0; i < statArrDecl_node->arr_size; ++i) {
-            print_asm(statArrDecl_node->arr_vals[i], state);
-            
-            std::string elem_name = statArrDecl_node->arr_name + std::to_string(i);
-            std::cout << "  mov QWORD PTR [rbp-" << 2 * state.vars[elem_name] << "], rax" << std::endl;
-        }
+            Result* size = traverse_tree(dynArrDecl_node->arr_size, state);
+            Result* val = traverse_tree(dynArrDecl_node->arr_val, state);
+            Result* res = traverse_tree(dynArrDecl_node->next, state);
         
-        print_asm(statArrDecl_node->next, state);
-    }
-    else if (dynArrDecl_node) {
-        int num = num_vars(dynArrDecl_node->arr_size, 0);
-        if (num == 0) {
-            int res = num_expr_eval(dynArrDecl_node->arr_size, 0);
-            std::cout << "  mov rax, " << std::to_string(res) << std::endl;
-        }
-        else {
-            print_asm(dynArrDecl_node->arr_size, state);
+            if (errResult(size)) return size;
+            else if (errResult(val)) return val;
+            else if (errResult(res)) return res;
+            break;
         }
-        std::cout << "  mov rdi, rax" << std::endl;
-        print_asm(dynArrDecl_node->arr_val, state);
-        std::cout << "  mov rsi, rax" << std::endl;
-        std::cout << "  call dyn_malloc" << std::endl;
-        
-        std::cout << "  mov QWORD PTR [rbp-" << 2*state.arrs[dynArrDecl_node->arr_name].first << "], rax" << std::endl;
-            
-        print_asm(dynArrDecl_node->next, state);
-    }
-    else if (if_else_node) {
-        auto* next_if_else = dynamic_cast<IfElseNode*>(if_else_node->next);
-        auto* next_while = dynamic_cast<WhileNode*>(if_else_node->next);
-        int n = if_else_node->conds.size();
+        case _IF_ELSE_NODE_ : {
+            auto* if_else_node = static_cast<IfElseNode*>(ptr);
+            int n = if_else_node->conds.size();
         
-        if (n == 1) {
-            std::cout << "if" << if_else_node->if_num << ":" << std::endl;
-            print_asm(if_else_node->conds[0].first, state);
-            std::cout << "  cmp rax, 1" << std::endl;
-            std::cout << "  je cond" << if_else_node->cond_num[0] << std::endl;
+            if (n == 1) {
+                Result* cond = traverse_tree(if_else_node->conds[0].first, state);
+                Result* stmts = traverse_tree(if_else_node->conds[0].second, state);
+                Result* res = traverse_tree(if_else_node->next, state);
             
-            if (next_if_else) {
-                std::cout << "  jmp if" << next_if_else->if_num << std::endl;
-            }
-            else if (next_while) {
-                std::cout << "  jmp loop" << next_while->while_num << std::endl;
+                if (errResult(cond)) return cond;
+                else if (errResult(stmts)) return stmts;
+                else if (errResult(res)) return res;
             }
             else {
-                std::cout << "  jmp main" << if_else_node->main_num << std::endl;
-            }
+                for (int i = 1; i < n; ++i) {
+                    Result* cond = traverse_tree(if_else_node->conds[i].first, state);
+                
+                    if (errResult(cond)) return cond;
+                }
+                // conds[0] is the else, or the last else-if when the else is empty
+                if (if_else_node->conds[0].first) {
+                    Result* cond = traverse_tree(if_else_node->conds[0].first, state);
+                    
+                    if (errResult(cond)) return cond;
+                }
             
-            std::cout << "cond" << if_else_node->cond_num[0] << ":" << std::endl;
-            print_asm(if_else_node->conds[0].second, state);
+                for (int i = 1; i < n; ++i) {
+                    Result* stmts = traverse_tree(if_else_node->conds[i].second, state);
                 
-            if (next_if_else) {
-                std::cout << "  jmp if" << next_if_else->if_num << std::endl; 
-            }
-            else if (next_while) {
-                std::cout << "  jmp loop" << next_while->while_num << std::endl;
-            }
-            else {
-                std::cout << "  jmp main" << if_else_node->main_num << std::endl;
-            }
+                    if (errResult(stmts)) return stmts;
+                }
+                Result* stmts = traverse_tree(if_else_node->conds[0].second, state);
+                Result* res = traverse_tree(if_else_node->next, state);
             
-            if (!(next_if_else || next_while)) {
-                std::cout << "main" << if_else_node->main_num << ":" << std::endl;
+                if (errResult(stmts)) return stmts;
+                else if (errResult(res)) return res;
             }
-            
-            print_asm(if_else_node->next, state);
+            break;
         }
-        else {
-            std::cout << "if" << if_else_node->if_num << ":" << std::endl;
-            int i;
-            for (i = 1; i < n; ++i) {
-                print_asm(if_else_node->conds[i].first, state);
-                std::cout << "  cmp rax, 1" << std::endl;
-                std::cout << "  je cond" << if_else_node->cond_num[i-1] << std::endl;
-            }
-            std::cout << "  jmp cond" << if_else_node->cond_num[i-1] << std::endl;
+        case _WHILE_NODE_ : {
+            auto* while_node = static_cast<WhileNode*>(ptr);
+        
+            Result* cond = traverse_tree(while_node->cond, state);
+            Result* stmts = traverse_tree(while_node->stmts, state);
+            Result* res = traverse_tree(while_node->next, state);
+        
+            if (errResult(cond)) return cond;
+            else if (errResult(stmts)) return stmts;
+            else if (errResult(res)) return res;
+            break;
+        }
+        case _FUNC_DEF_NODE_ : {
+            auto* funcDef_node = static_cast<FuncDef*>(ptr);
+            state->symtab.push_scope(true);
             
-            for (i = 1; i < n; ++i) {
-                std::cout << "cond" << if_else_node->cond_num[i-1] << ":" << std::endl;
-                print_asm(if_else_node->conds[i].second, state);
-                
-                if (next_if_else) {
-                    std::cout << "  jmp if" << next_if_else->if_num << std::endl; 
-                }
-                else if (next_while) {
-                    std::cout << "  jmp loop" << next_while->while_num << std::endl;
+            for (auto it : funcDef_node->func_args) {
+                auto* jt = node_cast<VarNode>(it);
+                if (jt) {
+                    jt->sym = state->symtab.define_var(jt->var_name, _VAR_);
                 }
-                else {
-                    std::cout << "  jmp main" << if_else_node->main_num << std::endl;
-                }
-            }
-            std::cout << "cond" << if_else_node->cond_num[i-1] << ":" << std::endl;
-            print_asm(if_else_node->conds[0].second, state);
-                
-            if (next_if_else) {
-                std::cout << "  jmp if" << next_if_else->if_num << std::endl; 
-            }
-            else if (next_while) {
-                std::cout << "  jmp loop" << next_while->while_num << std::endl;
-            }
-            else {
-                std::cout << "  jmp main" << if_else_node->main_num << std::endl;
-                std::cout << "main" << if_else_node->main_num << ":" << std::endl;
             }
-            print_asm(if_else_node->next, state);
-        }
         
-    }
-    else if (while_node) {
-        auto* next_while = dynamic_cast<WhileNode*>(while_node->next);
-        auto* next_if_else = dynamic_cast<IfElseNode*>(while_node->next);
+            state->symtab.define_func(funcDef_node->func_name, funcDef_node);
+            Result* func_res = funcDef_node->traverse_func_tree(funcDef_node->func_stmts, state);
+            state->symtab.pop_scope();
         
-        std::cout << "loop" << while_node->while_num << ":" << std::endl;
-        print_asm(while_node->cond, state);
-        std::cout << "  cmp rax, 0" << std::endl;
-        if (next_while) {
-            std::cout << "  je loop" << next_while->while_num << std::endl;
-        }
-        else if (next_if_else) {
-            std::cout << "  je if" << next_if_else->if_num << std::endl;
-        }
-        else {
-            std::cout << "  je main" << while_node->main_num << std::endl;
+            if (errResult(func_res)) return func_res;
+            if (funcDef_node->memo && funcDef_node->impure_line) {
+                return err_result(ErrType::_ERR_MEMO_, funcDef_node->impure_line, "Function '" + funcDef_node->func_name + "' is marked @memo but prints, scans or writes to an array!");
+            }
+        
+            Result* res = traverse_tree(funcDef_node->next, state);
+            if (errResult(res)) return res;
+            break;
         }
-        print_asm(while_node->stmts, state);
-        std::cout << "  jmp loop" << while_node->while_num << std::endl;
+        case _FUNC_CALL_NODE_ : {
+            auto* funcCall_node = static_cast<FuncCall*>(ptr);
+            if (!state->symtab.lookup(funcCall_node->func_name, _SYM_FUNC_)) {
+                return err_result(ErrType::_ERR_FUNC_EXIST_, funcCall_node->line_index, "Function '" + funcCall_node->func_name + "' not defined!");
+            }
         
-        if (!(next_while || next_if_else)) {
-            std::cout << "main" << while_node->main_num << ":" << std::endl;
+            for (auto it : funcCall_node->func_args) {
+                Result* tmp = traverse_tree(it, state);
+                if (errResult(tmp)) return tmp;
+            }
+            break;
         }
-        print_asm(while_node->next, state);
-    }
-    else if (funcDef_node) {
-        print_asm(funcDef_node->next, state);
+        default : break;
     }
+    
+    return ok_result();
 };
@@ -1,16 +1,40 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include "arena.hpp"
+#include "symtab.hpp"
+#include "emitter.hpp"
 
 #ifndef AST_HPP
 #define AST_HPP
 
+// Expression kinds first, statement kinds (from _MAIN_NODE_ on) after them
+enum NodeKind {
+    _NUM_NODE_, _VAR_NODE_, _ARR_ELEM_NODE_, _BIN_OP_NODE_,
+    _FUNC_CALL_NODE_, _MAIN_NODE_, _ASSIGN_NODE_, _STAT_ARR_DECL_NODE_,
+    _DYN_ARR_DECL_NODE_, _ARR_ELEM_ASSIGN_NODE_, _PRINT_NODE_, _SCAN_NODE_,
+    _ARR_PRINT_NODE_, _ARR_SCAN_NODE_, _IF_ELSE_NODE_, _WHILE_NODE_, _RETURN_NODE_, _FUNC_DEF_NODE_
+};
+
+// Every node carries its kind, so the passes dispatch with a single
+// switch instead of probing the node with a chain of dynamic_casts
 class ASTNode {
 public:
+    NodeKind kind;
     int line_index;
     virtual ~ASTNode() = default;
 };
 
+// Checked downcast through the kind tag (nullptr on mismatch)
+template <typename T>
+T* node_cast(ASTNode* ptr) {
+    return (ptr && ptr->kind == T::node_kind) ? static_cast<T*>(ptr) : nullptr;
+}
+
+inline bool is_stmt_node(ASTNode* ptr) {
+    return ptr && ptr->kind >= _MAIN_NODE_;
+}
+
 enum Tag {
     _ADD_, _SUB_, _MUL_, _DIV_,
     _MOD_, _SHL_, _SHR_, _LESS_,
@@ -19,35 +43,12 @@ enum Tag {
     _NEG_
 };
 
-enum VarType { _VAR_, _CONST_ };
-
-enum ArrayType { _STAT_, _DYN_ };
-   
-enum ErrType { _OK_, _ERR_VAR_, _ERR_ARR_, _ERR_FUNC_EXIST_, _ERR_CONST_ };
+enum ErrType { _OK_, _ERR_VAR_, _ERR_ARR_, _ERR_FUNC_EXIST_, _ERR_CONST_, _ERR_MEMO_ };
 
 typedef struct ProgState {
-    std::unordered_map<std::string, int> vars;
-    std::unordered_map<std::string, std::pair<int, ArrayType>> arrs;
-    std::unordered_map<std::string, ASTNode*> funcs;
-    int var_counter = 4;
-    int arrayDecl_loop = 0;
-    int main_counter = 0;
-    int loop_counter = 0;
-    int if_counter = 0;
-    int cond_counter = 0;
+    SymbolTable symtab;
 } ProgState;
 
-typedef struct FuncState {
-    std::unordered_map<std::string, int> vars;
-    std::unordered_map<std::string, std::pair<int, ArrayType>> arrs;
-    int var_counter = 4;
-    int arrayDecl_loop = 0;
-    int main_counter = 0;
-    int loop_counter = 0;
-    int if_counter = 0;
-    int cond_counter = 0;
-} FuncState;
-
 class Result {
 public:
     ErrType err;
@@ -60,27 +61,37 @@ public:
     };
 };
 
+// Successful visits share one result, errors are allocated in ast_arena
+Result* ok_result();
+Result* err_result(ErrType err, int err_index, std::string msg);
+
 class NumNode : public ASTNode {
 public:
+    static const NodeKind node_kind = _NUM_NODE_;
     int num;
     NumNode(int _line_index, int _num);
 };
 
 class VarNode : public ASTNode {
 public:
+    static const NodeKind node_kind = _VAR_NODE_;
     std::string var_name;
+    Symbol* sym = nullptr;
     VarNode(int _line_index, std::string _var_name);
 };
 
 class ArrayElemNode : public ASTNode {
 public:
+    static const NodeKind node_kind = _ARR_ELEM_NODE_;
     std::string arr_name;
     ASTNode* elem_index;
+    Symbol* sym = nullptr;
     ArrayElemNode(int _line_index, std::string _arr_name, ASTNode* _elem_index);
 };
 
 class BinaryNode : public ASTNode {
 public: 
+    static const NodeKind node_kind = _BIN_OP_NODE_;
     Tag tag;
     ASTNode* left;
     ASTNode* right;
@@ -94,6 +105,7 @@ public:
 
 class FuncCall : public ASTNode {
 public:
+    static const NodeKind node_kind = _FUNC_CALL_NODE_;
     std::string func_name;
     std::vector<ASTNode*> func_args;
     FuncCall(int _line_index, std::string _func_name, std::vector<ASTNode*> _func_args);
@@ -107,14 +119,17 @@ public:
 
 class MainNode : public StatementNode {
 public:
+    static const NodeKind node_kind = _MAIN_NODE_;
     MainNode(int _line_index, ASTNode* _next);
 };
 
 class AssignNode : public StatementNode {
 public:
+    static const NodeKind node_kind = _ASSIGN_NODE_;
     std::string var_name;
     VarType assign_ty;
     ASTNode* assign_val;  
+    Symbol* sym = nullptr;
     AssignNode(
         int _line_index,
         std::string _var_name,
@@ -126,9 +141,11 @@ public:
 
 class StatArrayDeclNode : public StatementNode {
 public:
+    static const NodeKind node_kind = _STAT_ARR_DECL_NODE_;
     std::string arr_name;
     int arr_size;
     std::vector<ASTNode*> arr_vals;
+    Symbol* sym = nullptr;
     
     StatArrayDeclNode(
         int _line_index,
@@ -141,14 +158,14 @@ public:
 
 class DynArrayDeclNode : public StatementNode {
 public:
-    int arrayDecl_loop;
+    static const NodeKind node_kind = _DYN_ARR_DECL_NODE_;
     std::string arr_name;
     ASTNode* arr_size;
     ASTNode* arr_val;
+    Symbol* sym = nullptr;
     
     DynArrayDeclNode(
         int _line_index,
-        int _arrayDecl_loop,
         std::string _arr_name,
         ASTNode* _arr_size,
         ASTNode* _arr_val,
@@ -158,9 +175,11 @@ public:
 
 class ArrayElemAssignNode : public StatementNode {
 public:
+    static const NodeKind node_kind = _ARR_ELEM_ASSIGN_NODE_;
     std::string arr_name;
     ASTNode* elem_index;
     ASTNode* assign_val;
+    Symbol* sym = nullptr;
     ArrayElemAssignNode(
         int _line_index,
         std::string _arr_name,
@@ -172,6 +191,7 @@ public:
 
 class PrintNode : public StatementNode {
 public:
+    static const NodeKind node_kind = _PRINT_NODE_;
     ASTNode* print_val; 
     PrintNode(
         int _line_index,
@@ -182,7 +202,9 @@ public:
 
 class ScanNode : public StatementNode {
 public:
+    static const NodeKind node_kind = _SCAN_NODE_;
     std::string var_name; 
+    Symbol* sym = nullptr;
     ScanNode(
         int _line_index,
         std::string _var_name,
@@ -190,32 +212,53 @@ public:
     );
 };
 
+// print(arr, n) and scan(arr, n): the first n elements in one go
+class ArrayPrintNode : public StatementNode {
+public:
+    static const NodeKind node_kind = _ARR_PRINT_NODE_;
+    std::string arr_name;
+    ASTNode* count;
+    Symbol* sym = nullptr;
+    ArrayPrintNode(
+        int _line_index,
+        std::string _arr_name,
+        ASTNode* _count,
+        ASTNode* _next
+    );
+};
+
+class ArrayScanNode : public StatementNode {
+public:
+    static const NodeKind node_kind = _ARR_SCAN_NODE_;
+    std::string arr_name;
+    ASTNode* count;
+    Symbol* sym = nullptr;
+    ArrayScanNode(
+        int _line_index,
+        std::string _arr_name,
+        ASTNode* _count,
+        ASTNode* _next
+    );
+};
+
 class IfElseNode : public StatementNode {
 public:
-    int if_num;
-    int main_num;
+    static const NodeKind node_kind = _IF_ELSE_NODE_;
     std::vector<std::pair<ASTNode*, ASTNode*>> conds; 
-    std::vector<int> cond_num;
     IfElseNode(
         int _line_index,
-        int _if_num,
-        int _main_num,
         std::vector<std::pair<ASTNode*, ASTNode*>> _conds,
-        std::vector<int> _cond_num,
         ASTNode* _next
     );
 };
 
 class WhileNode : public StatementNode {
 public:
-    int while_num;
-    int main_num;
+    static const NodeKind node_kind = _WHILE_NODE_;
     ASTNode* cond;
     ASTNode* stmts;
     WhileNode(
         int _line_index,
-        int _while_num,
-        int _main_num,
         ASTNode* _cond, 
         ASTNode* _stmts, 
         ASTNode* _next
@@ -224,26 +267,26 @@ public:
 
 class ReturnNode : public StatementNode {
 public:
+    static const NodeKind node_kind = _RETURN_NODE_;
     ASTNode* return_val;
     ReturnNode(int _line_index, ASTNode* _return_val, ASTNode* _next);
 };
 
 class FuncDef : public StatementNode {
 public:
+    static const NodeKind node_kind = _FUNC_DEF_NODE_;
     std::string func_name;
     std::vector<ASTNode*> func_args;
-    FuncState func_state;
     ASTNode* func_stmts;
-    FuncDef(int _line_index, std::string _func_name, std::vector<ASTNode*> _func_args, FuncState _func_state, 
-        ASTNode* _func_stmts, ASTNode* _next);
-    Result* traverse_func_tree(ASTNode* ptr, ProgState state);
-    void print_func_asm(ASTNode* ptr);
-private:
-    std::vector<std::string> asm_args = {"rdi", "rsi", "rdx", "rcx"};
+    // marked @memo, its results kept per arguments
+    bool memo;
+    // line of the first print, scan, array write or call of a function
+    // doing one of those, 0 when there is none
+    int impure_line;
+    FuncDef(int _line_index, std::string _func_name, std::vector<ASTNode*> _func_args, ASTNode* _func_stmts, ASTNode* _next);
+    Result* traverse_func_tree(ASTNode* ptr, ProgState* state);
 };
 
 Result* traverse_tree(ASTNode* ptr, ProgState* state);
 
-void print_asm(ASTNode* ptr, ProgState state);
-
 #endif
@@ -0,0 +1,53 @@
+#include "emitter.hpp"
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+AsmEmitter asm_out;
+
+AsmEmitter::AsmEmitter() {
+    bufs[_TEXT_SEC_].reserve(1 << 20);
+};
+
+size_t AsmEmitter::size() const {
+    size_t n = 0;
+    for (int i = 0; i < _NUM_SECS_; i++) { n += bufs[i].size(); }
+    return n;
+};
+
+bool AsmEmitter::write(const char* path) {
+    int fd = 1;
+    if (path) {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) { return false; }
+    }
+
+    struct iovec iov[_NUM_SECS_];
+    int cnt = 0;
+    for (int i = 0; i < _NUM_SECS_; i++) {
+        if (bufs[i].empty()) { continue; }
+        iov[cnt].iov_base = (void*)bufs[i].data();
+        iov[cnt].iov_len = bufs[i].size();
+        cnt++;
+    }
+
+    int first = 0;
+    while (first < cnt) {
+        ssize_t n = writev(fd, iov + first, cnt - first);
+        if (n < 0) {
+            if (path) { close(fd); }
+            return false;
+        }
+        while (first < cnt && (size_t)n >= iov[first].iov_len) {
+            n -= iov[first].iov_len;
+            first++;
+        }
+        if (first < cnt) {
+            iov[first].iov_base = (char*)iov[first].iov_base + n;
+            iov[first].iov_len -= n;
+        }
+    }
+
+    if (path) { return close(fd) == 0; }
+    return true;
+};
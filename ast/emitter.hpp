@@ -0,0 +1,51 @@
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#ifndef EMITTER_HPP
+#define EMITTER_HPP
+
+enum Section {
+    _HEADER_SEC_,
+    _DATA_SEC_,
+    _TEXT_SEC_,
+    _NUM_SECS_
+};
+
+// Collects generated assembly in per-section buffers and writes the whole
+// program out with a single write at the end instead of flushing per line.
+class AsmEmitter {
+public:
+    AsmEmitter();
+    AsmEmitter(const AsmEmitter&) = delete;
+    AsmEmitter& operator=(const AsmEmitter&) = delete;
+
+    void section(Section _sec) { cur = _sec; }
+    Section current() const { return cur; }
+
+    AsmEmitter& operator<<(std::string_view s) { bufs[cur].append(s); return *this; }
+    AsmEmitter& operator<<(const std::string& s) { bufs[cur].append(s); return *this; }
+    AsmEmitter& operator<<(const char* s) { bufs[cur].append(s); return *this; }
+    AsmEmitter& operator<<(char c) { bufs[cur].push_back(c); return *this; }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    AsmEmitter& operator<<(T n) {
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), n);
+        bufs[cur].append(tmp, res.ptr - tmp);
+        return *this;
+    }
+
+    size_t size() const;
+    // Writes all sections in order to path (stdout when null) in one writev.
+    bool write(const char* path);
+
+private:
+    std::string bufs[_NUM_SECS_];
+    Section cur = _TEXT_SEC_;
+};
+
+extern AsmEmitter asm_out;
+
+#endif
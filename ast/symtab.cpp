@@ -0,0 +1,68 @@
+#include "symtab.hpp"
+#include "arena.hpp"
+
+Scope::Scope(Scope* _parent, bool _is_frame) {
+    parent = _parent;
+    is_frame = _is_frame;
+};
+
+// The global scope is a member, not an arena object, so a SymbolTable can
+// be constructed during static initialisation
+SymbolTable::SymbolTable() : global(nullptr, true) {
+    current = &global;
+};
+
+Scope* SymbolTable::push_scope(bool is_frame) {
+    current = ast_arena.make<Scope>(current, is_frame);
+    return current;
+};
+
+void SymbolTable::pop_scope() {
+    if (current->parent) current = current->parent;
+};
+
+Symbol* SymbolTable::lookup(const std::string& name, SymKind kind) {
+    if (kind == _SYM_FUNC_) {
+        auto it = global.syms.find(name);
+        return (it != global.syms.end() && it->second.sym_kind == kind) ? &it->second : nullptr;
+    }
+    
+    for (Scope* scope = current; scope; scope = scope->parent) {
+        auto it = scope->syms.find(name);
+        if (it != scope->syms.end() && it->second.sym_kind == kind) return &it->second;
+        if (scope->is_frame) break;
+    }
+    
+    return nullptr;
+};
+
+Symbol* SymbolTable::insert(Scope* scope, const std::string& name, SymKind kind) {
+    Symbol& sym = scope->syms[name];
+    sym.sym_kind = kind;
+    sym.name = name;
+    return &sym;
+};
+
+Symbol* SymbolTable::define_var(const std::string& name, VarType ty) {
+    Symbol* sym = insert(current, name, _SYM_VAR_);
+    sym->var_ty = ty;
+    return sym;
+};
+
+Symbol* SymbolTable::define_arr(const std::string& name, ArrayType ty, int size) {
+    Symbol* sym = insert(current, name, _SYM_ARR_);
+    sym->arr_ty = ty;
+    sym->arr_size = size;
+    return sym;
+};
+
+Symbol* SymbolTable::define_func(const std::string& name, ASTNode* func) {
+    auto it = global.syms.find(name);
+    bool fresh = (it == global.syms.end());
+    
+    Symbol* sym = insert(&global, name, _SYM_FUNC_);
+    sym->func_node = func;
+    if (fresh) global.funcs.push_back(sym);
+    
+    return sym;
+};
@@ -0,0 +1,60 @@
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#ifndef SYMTAB_HPP
+#define SYMTAB_HPP
+
+class ASTNode;
+
+enum VarType { _VAR_, _CONST_ };
+
+enum ArrayType { _STAT_, _DYN_ };
+
+enum SymKind { _SYM_VAR_, _SYM_ARR_, _SYM_FUNC_ };
+
+class Symbol {
+public:
+    SymKind sym_kind;
+    std::string name;
+    VarType var_ty = _VAR_;
+    ArrayType arr_ty = _DYN_;
+    int arr_size = 0;
+    ASTNode* func_node = nullptr;
+};
+
+// A lexical scope. Frame scopes are main and every function; lookups of
+// variables and arrays never cross a frame boundary.
+class Scope {
+public:
+    Scope* parent;
+    bool is_frame;
+    std::unordered_map<std::string, Symbol> syms;
+    std::vector<Symbol*> funcs;
+    
+    Scope(Scope* _parent, bool _is_frame);
+};
+
+// Symbols are resolved once, during semantic analysis, and the nodes keep
+// pointers to them, so the emitters never search or copy the table.
+// Scopes are allocated in ast_arena and outlive pop_scope().
+class SymbolTable {
+public:
+    Scope global;
+    Scope* current;
+    
+    SymbolTable();
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+    Scope* push_scope(bool is_frame);
+    void pop_scope();
+    
+    Symbol* lookup(const std::string& name, SymKind kind);
+    Symbol* define_var(const std::string& name, VarType ty);
+    Symbol* define_arr(const std::string& name, ArrayType ty, int size);
+    Symbol* define_func(const std::string& name, ASTNode* func);
+private:
+    Symbol* insert(Scope* scope, const std::string& name, SymKind kind);
+};
+
+#endif
@@ -0,0 +1,331 @@
+#include "peephole.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+#include <cstdint>
+
+// General purpose registers by number, 64-bit names first, then the 32-
+// and 8-bit aliases in the same order
+static const char* REG_NAMES[3][16] = {
+    {"rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "rsp", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"},
+    {"eax", "ebx", "ecx", "edx", "esi", "edi", "ebp", "esp", "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+    {"al", "bl", "cl", "dl", "sil", "dil", "bpl", "spl", "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"}
+};
+const int RAX = 0, RDX = 3, RBP = 6, RSP = 7;
+
+static bool is_word(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+};
+
+// Same as ==, without the library call the comparison makes
+static bool equals(const std::string& str, const char* lit) {
+    size_t i = 0;
+    for (; lit[i]; ++i) {
+        if (i == str.size() || str[i] != lit[i]) { return false; }
+    }
+    return i == str.size();
+};
+
+static bool is_op(const AsmInst& inst, const char* op) {
+    return equals(inst.op, op);
+};
+
+// Up to eight characters of str packed into an integer, one per byte, so
+// register names and mnemonics can be looked up without building strings
+static uint64_t pack(const std::string& str, size_t pos, size_t len) {
+    uint64_t key = 0;
+    for (size_t k = 0; k < len; ++k) { key = key << 8 | (unsigned char)str[pos + k]; }
+    return key;
+};
+
+static std::unordered_map<uint64_t, int> reg_numbers() {
+    std::unordered_map<uint64_t, int> numbers;
+    for (int w = 0; w < 3; ++w) {
+        for (int r = 0; r < 16; ++r) {
+            std::string name = REG_NAMES[w][r];
+            numbers[pack(name, 0, name.size())] = r;
+        }
+    }
+    return numbers;
+};
+
+// Register named by the len characters of opnd at pos, -1 if none
+static int reg_number(const std::string& opnd, size_t pos, size_t len) {
+    static const auto numbers = reg_numbers();
+    if (len < 2 || len > 4) { return -1; }
+    auto it = numbers.find(pack(opnd, pos, len));
+    return it == numbers.end() ? -1 : it->second;
+};
+
+// Number of the 64-bit register opnd is, -1 for anything else
+static int reg64(const std::string& opnd) {
+    if (opnd.size() < 2 || opnd.size() > 3 || opnd[0] != 'r') { return -1; }
+    for (int r = 0; r < 16; ++r) {
+        if (equals(opnd, REG_NAMES[0][r])) { return r; }
+    }
+    return -1;
+};
+
+static bool is_mem(const std::string& opnd) {
+    return opnd.find('[') != std::string::npos;
+};
+
+// Whether register r or one of its aliases appears anywhere in opnd,
+// addresses included
+static bool mentions(const std::string& opnd, int r) {
+    size_t i = 0;
+    while (i < opnd.size()) {
+        if (!is_word(opnd[i])) {
+            ++i;
+            continue;
+        }
+        size_t j = i;
+        while (j < opnd.size() && is_word(opnd[j])) { ++j; }
+        if (reg_number(opnd, i, j - i) == r) { return true; }
+        i = j;
+    }
+    return false;
+};
+
+// Control leaves the straight line here, so nothing past it is known
+static bool ends_window(const AsmInst& inst) {
+    return inst.is_label || inst.op[0] == 'j' || is_op(inst, "call") || is_op(inst, "ret") || is_op(inst, "leave");
+};
+
+static bool reads(const AsmInst& inst, int r) {
+    if (is_op(inst, "cqo")) { return r == RAX; }
+    // one-operand multiply and divide work on rdx:rax
+    if ((is_op(inst, "idiv") || is_op(inst, "imul")) && inst.args.size() == 1 && (r == RAX || r == RDX)) { return true; }
+    // the zeroing idiom does not depend on the old value
+    if (is_op(inst, "xor") && inst.args[0] == inst.args[1] && !is_mem(inst.args[0])) { return false; }
+
+    bool writes_first = is_op(inst, "mov") || is_op(inst, "lea") || is_op(inst, "movzx") || (is_op(inst, "imul") && inst.args.size() == 3);
+    for (int i = 0; i < (int)inst.args.size(); ++i) {
+        if (i == 0 && writes_first && !is_mem(inst.args[0])) { continue; }
+        if (mentions(inst.args[i], r)) { return true; }
+    }
+    return false;
+};
+
+// Whether inst sets all 64 bits of r without looking at them
+static bool overwrites(const AsmInst& inst, int r) {
+    if (is_op(inst, "cqo")) { return r == RDX; }
+    if (inst.args.empty() || reads(inst, r)) { return false; }
+    const std::string& dst = inst.args[0];
+    if (is_op(inst, "mov") || is_op(inst, "lea") || is_op(inst, "imul")) { return reg64(dst) == r; }
+    // 32-bit writes clear the upper half
+    if (is_op(inst, "movzx") || is_op(inst, "xor")) { return reg64(dst) == r || equals(dst, REG_NAMES[1][r]); }
+    return false;
+};
+
+// How far past an instruction the rules look for a read or a write
+const int WINDOW = 16;
+
+static int next_inst(const std::vector<AsmInst>& code, int i) {
+    for (++i; i < (int)code.size(); ++i) {
+        if (code[i].is_label || !code[i].op.empty()) { return i; }
+    }
+    return -1;
+};
+
+// r is written again before anything reads it, within the straight line
+static bool reg_dead_after(const std::vector<AsmInst>& code, int i, int r) {
+    int seen = 0;
+    for (int j = next_inst(code, i); j >= 0; j = next_inst(code, j)) {
+        if (seen++ == WINDOW) { return false; }
+        if (ends_window(code[j]) || reads(code[j], r)) { return false; }
+        if (overwrites(code[j], r)) { return true; }
+    }
+    return false;
+};
+
+// Nothing reads the flags before they are set again
+static bool flags_dead_after(const std::vector<AsmInst>& code, int i) {
+    int seen = 0;
+    for (int j = next_inst(code, i); j >= 0; j = next_inst(code, j)) {
+        if (seen++ == WINDOW) { return false; }
+        const AsmInst& inst = code[j];
+        if (inst.is_label || inst.op[0] == 'j' || inst.op.compare(0, 3, "set") == 0) { return false; }
+        if (is_op(inst, "call") || is_op(inst, "ret")) { return true; }
+        if (is_op(inst, "cmp") || is_op(inst, "test") || is_op(inst, "add") || is_op(inst, "sub") || is_op(inst, "and") || is_op(inst, "or") || is_op(inst, "xor") || is_op(inst, "imul") || is_op(inst, "neg")) { return true; }
+    }
+    return true;
+};
+
+static bool is_zero(const std::string& opnd) {
+    return equals(opnd, "0");
+};
+
+static void remove(AsmInst& inst) {
+    inst.op.clear();
+    inst.args.clear();
+};
+
+// mov a, a
+static bool self_move(std::vector<AsmInst>& code, int i) {
+    AsmInst& inst = code[i];
+    if (inst.args[0] != inst.args[1]) { return false; }
+    remove(inst);
+    return true;
+};
+
+// mov a, b / mov b, a: the second one changes nothing
+static bool move_back(std::vector<AsmInst>& code, int i) {
+    AsmInst& inst = code[i];
+    int j = next_inst(code, i);
+    if (j < 0 || !is_op(code[j], "mov")) { return false; }
+    if (code[j].args[0] != inst.args[1] || code[j].args[1] != inst.args[0]) { return false; }
+    remove(code[j]);
+    return true;
+};
+
+// mov [m], r / mov r2, [m] and mov r, [m] / mov r2, [m]: the value is
+// still in r
+static bool reload(std::vector<AsmInst>& code, int i) {
+    AsmInst& inst = code[i];
+    int j = next_inst(code, i);
+    if (j < 0 || !is_op(code[j], "mov") || reg64(code[j].args[0]) < 0) { return false; }
+
+    int r;
+    std::string mem;
+    if (is_mem(inst.args[0]) && reg64(inst.args[1]) >= 0) {
+        r = reg64(inst.args[1]);
+        mem = inst.args[0];
+    }
+    else if (reg64(inst.args[0]) >= 0 && is_mem(inst.args[1]) && !mentions(inst.args[1], reg64(inst.args[0]))) {
+        r = reg64(inst.args[0]);
+        mem = inst.args[1];
+    }
+    else {
+        return false;
+    }
+    if (code[j].args[1] != mem) { return false; }
+
+    if (reg64(code[j].args[0]) == r) { remove(code[j]); }
+    else { code[j].args[1] = REG_NAMES[0][r]; }
+    return true;
+};
+
+// jmp L straight into L
+static bool jump_next(std::vector<AsmInst>& code, int i) {
+    AsmInst& inst = code[i];
+    for (int j = next_inst(code, i); j >= 0 && code[j].is_label; j = next_inst(code, j)) {
+        if (code[j].op == inst.args[0]) {
+            remove(inst);
+            return true;
+        }
+    }
+    return false;
+};
+
+// cmp r, 0 sets the flags exactly like the shorter test r, r
+static bool cmp_zero(std::vector<AsmInst>& code, int i) {
+    AsmInst& inst = code[i];
+    if (reg64(inst.args[0]) < 0 || !is_zero(inst.args[1])) { return false; }
+    inst.op = "test";
+    inst.args[1] = inst.args[0];
+    return true;
+};
+
+// mov r, 0 becomes the shorter xor r32, r32 where the flags it clobbers
+// are dead
+static bool zero_reg(std::vector<AsmInst>& code, int i) {
+    AsmInst& inst = code[i];
+    if (reg64(inst.args[0]) < 0 || !is_zero(inst.args[1]) || !flags_dead_after(code, i)) { return false; }
+    std::string narrow = REG_NAMES[1][reg64(inst.args[0])];
+    inst.op = "xor";
+    inst.args = {narrow, narrow};
+    return true;
+};
+
+// imul r, r, -1 is neg r
+static bool mul_neg(std::vector<AsmInst>& code, int i) {
+    AsmInst& inst = code[i];
+    if (inst.args.size() != 3 || inst.args[0] != inst.args[1] || !equals(inst.args[2], "-1")) { return false; }
+    inst.op = "neg";
+    inst.args.resize(1);
+    return true;
+};
+
+// add r, 0 / sub r, 0 / or r, 0 / imul r, r, 1
+static bool identity(std::vector<AsmInst>& code, int i) {
+    AsmInst& inst = code[i];
+    bool noop = is_op(inst, "imul") ? inst.args.size() == 3 && inst.args[0] == inst.args[1] && equals(inst.args[2], "1") : is_zero(inst.args[1]);
+    if (!noop || !flags_dead_after(code, i)) { return false; }
+    remove(inst);
+    return true;
+};
+
+// A register written and overwritten again before anything reads it
+static bool dead_move(std::vector<AsmInst>& code, int i) {
+    AsmInst& inst = code[i];
+    int r = reg64(inst.args[0]);
+    if (r < 0 || r == RSP || r == RBP || !reg_dead_after(code, i, r)) { return false; }
+    remove(inst);
+    return true;
+};
+
+struct PeepholeRule {
+    const char* name;
+    // mnemonics, separated by spaces, of the instruction the pattern
+    // starts at
+    const char* ops;
+    // Tries the rule on the instruction at i, returns whether it rewrote
+    // anything
+    bool (*apply)(std::vector<AsmInst>& code, int i);
+    long hits;
+};
+
+// New rules go here; they are tried in order on every instruction
+static PeepholeRule rules[] = {
+    {"self-move", "mov", self_move, 0},
+    {"move-back", "mov", move_back, 0},
+    {"reload", "mov", reload, 0},
+    {"dead-move", "mov lea", dead_move, 0},
+    {"jump-next", "jmp", jump_next, 0},
+    {"identity", "add sub or imul", identity, 0},
+    {"mul-neg", "imul", mul_neg, 0},
+    {"cmp-zero", "cmp", cmp_zero, 0},
+    {"zero-reg", "mov", zero_reg, 0},
+};
+
+static std::unordered_map<uint64_t, std::vector<PeepholeRule*>> rules_by_op() {
+    std::unordered_map<uint64_t, std::vector<PeepholeRule*>> by_op;
+    for (auto& rule : rules) {
+        std::istringstream ops(rule.ops);
+        std::string op;
+        while (ops >> op) { by_op[pack(op, 0, op.size())].push_back(&rule); }
+    }
+    return by_op;
+};
+
+const int MAX_PASSES = 4;
+
+// A rewritten instruction is looked at again on the next pass, which runs
+// while the previous one changed anything
+void run_peephole(std::vector<AsmInst>& code) {
+    static const auto by_op = rules_by_op();
+    bool changed = true;
+    for (int pass = 0; changed && pass < MAX_PASSES; ++pass) {
+        changed = false;
+        for (int i = 0; i < (int)code.size(); ++i) {
+            if (code[i].is_label || code[i].op.size() > 8) { continue; }
+            auto it = by_op.find(pack(code[i].op, 0, code[i].op.size()));
+            if (it == by_op.end()) { continue; }
+            for (auto* rule : it->second) {
+                if (rule->apply(code, i)) {
+                    rule->hits++;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+};
+
+void print_peephole_stats() {
+    for (auto& rule : rules) {
+        std::cerr << std::left << std::setw(12) << rule.name << rule.hits << '\n';
+    }
+};
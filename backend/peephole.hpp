@@ -0,0 +1,21 @@
+#include <string>
+#include <vector>
+
+#ifndef PEEPHOLE_HPP
+#define PEEPHOLE_HPP
+
+// One line of a function's assembly in Intel syntax: an instruction and
+// its operands, or a label named by op. An instruction whose op is empty
+// has been removed.
+struct AsmInst {
+    std::string op;
+    std::vector<std::string> args;
+    bool is_label = false;
+};
+
+// Rewrites code with the rules of the peephole table until none applies
+void run_peephole(std::vector<AsmInst>& code);
+// Prints how often each rule fired over the whole program to stderr
+void print_peephole_stats();
+
+#endif
@@ -0,0 +1,1277 @@
+#include "x86.hpp"
+#include "peephole.hpp"
+#include <algorithm>
+#include <climits>
+#include <iterator>
+
+static const char* ARG_REGS[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+const int NUM_ARG_REGS = 6;
+// rax, rcx, rdx and r11 are never allocated and serve as scratch
+// caller-saved registers first, then callee-saved ones
+static const char* ALLOC_REGS[] = {"rsi", "rdi", "r8", "r9", "r10", "rbx", "r12", "r13", "r14", "r15"};
+const int NUM_ALLOC_REGS = 10;
+const int NUM_CALLER_SAVED = 5;
+
+static const char* cond_code(Tag cc) {
+    switch (cc) {
+        case _LESS_ : return "l";
+        case _GREAT_ : return "g";
+        case _EQ_ : return "e";
+        case _NEQ_ : return "ne";
+        case _LEQ_ : return "le";
+        case _GEQ_ : return "ge";
+        default : return "e";
+    }
+};
+
+static Tag negate_cc(Tag cc) {
+    switch (cc) {
+        case _LESS_ : return _GEQ_;
+        case _GREAT_ : return _LEQ_;
+        case _EQ_ : return _NEQ_;
+        case _NEQ_ : return _EQ_;
+        case _LEQ_ : return _GREAT_;
+        case _GEQ_ : return _LESS_;
+        default : return cc;
+    }
+};
+
+// Condition that holds for (b, a) when cc holds for (a, b)
+static Tag swap_cc(Tag cc) {
+    switch (cc) {
+        case _LESS_ : return _GREAT_;
+        case _GREAT_ : return _LESS_;
+        case _LEQ_ : return _GEQ_;
+        case _GEQ_ : return _LEQ_;
+        default : return cc;
+    }
+};
+
+static bool is_two_address(IROp op) {
+    switch (op) {
+        case _IR_ADD_ :
+        case _IR_SUB_ :
+        case _IR_MUL_ :
+        case _IR_SHL_ :
+        case _IR_SHR_ :
+        case _IR_AND_ :
+        case _IR_OR_ :
+        case _IR_NOT_ :
+        case _IR_NEG_ : return true;
+        default : return false;
+    }
+};
+
+static bool fits_imm32(int64_t val) {
+    return val >= INT32_MIN && val <= INT32_MAX;
+};
+
+// k when val is 2^k, -1 otherwise
+static int log2_exact(uint64_t val) {
+    if (val == 0 || (val & (val - 1)) != 0) { return -1; }
+    return __builtin_ctzll(val);
+};
+
+// Multiplier and shift that turn signed division by d into a high
+// multiply, for 2 <= |d|, after Hacker's Delight 10-1
+static void signed_magic(int64_t d, int64_t& mult, int& shift) {
+    const uint64_t two63 = 1ULL << 63;
+    uint64_t ad = d < 0 ? 0 - (uint64_t)d : d;
+    uint64_t t = two63 + ((uint64_t)d >> 63);
+    uint64_t anc = t - 1 - t % ad;
+    uint64_t q1 = two63 / anc, r1 = two63 - q1 * anc;
+    uint64_t q2 = two63 / ad, r2 = two63 - q2 * ad;
+    uint64_t delta;
+    int p = 63;
+    do {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            ++q2;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    mult = q2 + 1;
+    if (d < 0) { mult = 0 - (uint64_t)mult; }
+    shift = p - 64;
+};
+
+struct Move {
+    std::string dst;
+    std::string src;
+    bool lea;
+};
+
+// Emits the register moves in an order that never overwrites a pending
+// source, breaking cycles with xchg.
+static void parallel_move(std::vector<AsmInst>& code, std::vector<Move> moves) {
+    moves.erase(std::remove_if(moves.begin(), moves.end(), [](const Move& m) { return !m.lea && m.dst == m.src; }), moves.end());
+
+    while (!moves.empty()) {
+        int ready = -1;
+        for (int i = 0; i < (int)moves.size() && ready < 0; ++i) {
+            bool blocked = false;
+            for (int j = 0; j < (int)moves.size(); ++j) {
+                if (j != i && !moves[j].lea && moves[j].src == moves[i].dst) { blocked = true; break; }
+            }
+            if (!blocked) { ready = i; }
+        }
+
+        if (ready >= 0) {
+            Move m = moves[ready];
+            code.push_back({m.lea ? "lea" : "mov", {m.dst, m.src}});
+            moves.erase(moves.begin() + ready);
+            continue;
+        }
+
+        Move m = moves[0];
+        code.push_back({"xchg", {m.dst, m.src}});
+        moves.erase(moves.begin());
+        for (auto& other : moves) {
+            if (!other.lea && other.src == m.dst) { other.src = m.src; }
+        }
+        moves.erase(std::remove_if(moves.begin(), moves.end(), [](const Move& o) { return !o.lea && o.dst == o.src; }), moves.end());
+    }
+};
+
+// Code generation for one function. Vregs get registers by linear scan
+// over live ranges with holes: a vreg occupies its register only where it
+// is live, and the two sides of a copy whose ranges never meet are merged
+// into one interval first, so the copy disappears.
+// Intervals spanning a call only get callee-saved registers; when none is
+// left the interval with the least loop-weighted use count lives in a
+// frame slot for its whole life.
+class X86Gen {
+public:
+    X86Gen(IRFunction* _func);
+    void run(bool optimize);
+
+private:
+    struct Interval {
+        // disjoint [from, to) positions, ascending
+        std::vector<std::pair<int, int>> ranges;
+        long weight = 0;
+        bool crosses_call = false;
+        // vreg whose register this one would rather share (copies)
+        int hint = -1;
+        // allocatable register a parameter arrives in
+        int pref = -1;
+
+        int start() const { return ranges.front().first; }
+        int end() const { return ranges.back().second; }
+        bool covers(int pos) const;
+        bool intersects(const Interval& other) const;
+    };
+
+    IRFunction* func;
+    std::vector<Interval> intervals;
+    // vreg whose interval stands for this one after coalescing
+    std::vector<int> leader;
+    std::vector<std::string> reg;
+    std::vector<int> slot;
+    std::vector<int> arr_offset;
+    std::vector<std::string> saved;
+    std::vector<int> saved_offset;
+    int frame = 0;
+    int num_vloops = 0;
+    int num_fills = 0;
+    // (label, check) for every bounds check, reported after the code
+    std::vector<std::pair<std::string, const IRInst*>> failed_checks;
+    std::vector<AsmInst> code;
+
+    void build_intervals();
+    int find_leader(int vreg);
+    void coalesce();
+    void allocate();
+    void layout_frame();
+    void put(const std::string& op, std::vector<std::string> args = {});
+    std::string label(BasicBlock* bb);
+    bool in_mem(const Operand& opnd);
+    std::string loc(int vreg);
+    std::string src(const Operand& opnd, const char* scratch);
+    void load(const std::string& dst_reg, const Operand& opnd);
+    void store(int dst, const std::string& src_reg);
+    void move_to(int dst, const Operand& opnd);
+    std::string elem_addr(const Operand& base, const Operand& idx);
+    Tag emit_cmp(Operand a, Operand b, Tag cc);
+    void emit_alu(IRInst& inst);
+    void emit_mul_imm(const std::string& target, const Operand& a, int64_t c);
+    void emit_div(IRInst& inst);
+    void emit_shift(IRInst& inst);
+    void emit_vloop(IRInst& inst);
+    void emit_fill(IRInst& inst);
+    void emit_check(IRInst& inst);
+    void emit_check_failures();
+    void emit_call(const std::string& name, std::vector<Move> moves, int dst, bool varargs, int stack = 0);
+    std::vector<Move> arg_moves(const std::vector<Operand>& args, int first);
+    int push_stack_args(const std::vector<Operand>& args);
+    void emit_epilogue(const std::string& target = "");
+    bool is_tail_call(BasicBlock* bb, int k);
+    void emit_inst(IRInst& inst, BasicBlock* bb, BasicBlock* next);
+};
+
+bool X86Gen::Interval::covers(int pos) const {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), std::make_pair(pos, INT_MAX));
+    return it != ranges.begin() && pos < std::prev(it)->second;
+};
+
+// Ranges ending before other starts cannot meet it, so both walks begin at
+// the later start
+bool X86Gen::Interval::intersects(const Interval& other) const {
+    int from = std::max(start(), other.start());
+    auto past = [from](const std::pair<int, int>& range, int) { return range.second <= from; };
+    auto a = std::lower_bound(ranges.begin(), ranges.end(), 0, past);
+    auto b = std::lower_bound(other.ranges.begin(), other.ranges.end(), 0, past);
+    while (a != ranges.end() && b != other.ranges.end()) {
+        if (a->first < b->second && b->first < a->second) { return true; }
+        if (a->second <= b->second) { ++a; }
+        else { ++b; }
+    }
+    return false;
+};
+
+X86Gen::X86Gen(IRFunction* _func) {
+    func = _func;
+};
+
+// Instructions sit 4 apart. A vreg live into a block is live from just
+// before its first instruction, one live out of it until just after its
+// last, a use ends a range and a definition starts one, so an
+// instruction's result may reuse the register of an operand dying there.
+void X86Gen::build_intervals() {
+    Liveness live(func);
+    intervals.assign(func->num_vregs, Interval());
+    std::vector<int> open(func->num_vregs, -1);
+    std::vector<int> calls;
+    std::vector<int> opened;
+
+    int pos = 0;
+    for (auto* bb : func->blocks) {
+        int first = pos + 4;
+        int last = pos += 4 * bb->insts.size();
+        long weight = 1L << (3 * std::min(bb->loop_depth, 6));
+
+        opened.clear();
+        for (int w = 0; w < (int)live.live_out[bb->index].words.size(); ++w) {
+            for (uint64_t bits = live.live_out[bb->index].words[w]; bits; bits &= bits - 1) {
+                int v = live.vregs[64 * w + __builtin_ctzll(bits)];
+                open[v] = last + 1;
+                opened.push_back(v);
+            }
+        }
+
+        int at = last;
+        for (auto it = bb->insts.rbegin(); it != bb->insts.rend(); ++it, at -= 4) {
+            IRInst& inst = *it;
+            if (inst.dst >= 0) {
+                Interval& iv = intervals[inst.dst];
+                // a dead result still takes its register for a moment;
+                // parameters all leave their registers on entry, so they
+                // hold theirs from there
+                int from = inst.op == _IR_PARAM_ ? first - 1 : at;
+                iv.ranges.push_back({from, open[inst.dst] >= 0 ? open[inst.dst] : at + 1});
+                iv.weight += weight;
+                open[inst.dst] = -1;
+            }
+            for (auto& arg : inst.args) {
+                if (!arg.is_vreg()) { continue; }
+                intervals[arg.val].weight += weight;
+                if (open[arg.val] < 0) {
+                    open[arg.val] = at;
+                    opened.push_back(arg.val);
+                }
+            }
+            if (inst.is_call()) { calls.push_back(at); }
+
+            if (inst.op == _IR_COPY_ && inst.args[0].is_vreg()) { intervals[inst.dst].hint = inst.args[0].val; }
+            // two-address results would rather overwrite their left operand
+            if (inst.dst >= 0 && is_two_address(inst.op)) {
+                bool ordered = inst.op == _IR_SUB_ || inst.op == _IR_SHL_ || inst.op == _IR_SHR_;
+                const Operand& left = inst.args[0].is_vreg() || ordered || inst.args.size() < 2 ? inst.args[0] : inst.args[1];
+                if (left.is_vreg()) { intervals[inst.dst].hint = left.val; }
+            }
+            if (inst.op == _IR_PARAM_ && inst.args[0].val < NUM_ARG_REGS) {
+                auto* it = std::find_if(ALLOC_REGS, ALLOC_REGS + NUM_ALLOC_REGS, [&](const char* r) { return std::string(r) == ARG_REGS[inst.args[0].val]; });
+                intervals[inst.dst].pref = it != ALLOC_REGS + NUM_ALLOC_REGS ? it - ALLOC_REGS : -1;
+            }
+        }
+
+        for (int v : opened) {
+            if (open[v] < 0) { continue; }
+            intervals[v].ranges.push_back({first - 1, open[v]});
+            open[v] = -1;
+        }
+    }
+
+    std::sort(calls.begin(), calls.end());
+    for (auto& iv : intervals) {
+        std::sort(iv.ranges.begin(), iv.ranges.end());
+        for (auto& range : iv.ranges) {
+            auto it = std::upper_bound(calls.begin(), calls.end(), range.first);
+            if (it != calls.end() && *it < range.second) { iv.crosses_call = true; }
+        }
+    }
+};
+
+int X86Gen::find_leader(int vreg) {
+    while (leader[vreg] != vreg) { vreg = leader[vreg] = leader[leader[vreg]]; }
+    return vreg;
+};
+
+// Copies in the deepest loops are tried first. A leader's interval covers
+// its whole group, members keep their own for reference.
+void X86Gen::coalesce() {
+    leader.resize(intervals.size());
+    for (int v = 0; v < (int)leader.size(); ++v) { leader[v] = v; }
+
+    std::vector<BasicBlock*> order = func->blocks;
+    std::stable_sort(order.begin(), order.end(), [](BasicBlock* a, BasicBlock* b) { return a->loop_depth > b->loop_depth; });
+    for (auto* bb : order) {
+        for (auto& inst : bb->insts) {
+            if (inst.op != _IR_COPY_ || !inst.args[0].is_vreg()) { continue; }
+            int a = find_leader(inst.dst), b = find_leader(inst.args[0].val);
+            if (a == b || intervals[a].intersects(intervals[b])) { continue; }
+
+            Interval& into = intervals[a];
+            Interval& from = intervals[b];
+            std::vector<std::pair<int, int>> ranges;
+            std::merge(into.ranges.begin(), into.ranges.end(), from.ranges.begin(), from.ranges.end(), std::back_inserter(ranges));
+            into.ranges = ranges;
+            into.weight += from.weight;
+            into.crosses_call |= from.crosses_call;
+            if (into.pref < 0) { into.pref = from.pref; }
+            leader[b] = a;
+        }
+    }
+};
+
+void X86Gen::allocate() {
+    std::vector<int> order;
+    for (int v = 0; v < (int)intervals.size(); ++v) {
+        if (!intervals[v].ranges.empty() && find_leader(v) == v) { order.push_back(v); }
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return intervals[a].start() < intervals[b].start(); });
+
+    // index into ALLOC_REGS per vreg, -1 while in memory
+    std::vector<int> assigned(intervals.size(), -1);
+    const unsigned all_regs = (1u << NUM_ALLOC_REGS) - 1;
+    const unsigned callee_saved = all_regs & ~((1u << NUM_CALLER_SAVED) - 1);
+
+    // active intervals cover the current position, inactive ones are in a
+    // hole there and may take their register back later
+    std::vector<int> active, inactive, still_active, still_inactive;
+    for (int cur : order) {
+        Interval& iv = intervals[cur];
+        int pos = iv.start();
+
+        still_active.clear();
+        still_inactive.clear();
+        for (int list = 0; list < 2; ++list) {
+            for (int a : list ? inactive : active) {
+                if (intervals[a].end() <= pos) { continue; }
+                (intervals[a].covers(pos) ? still_active : still_inactive).push_back(a);
+            }
+        }
+        active.swap(still_active);
+        inactive.swap(still_inactive);
+
+        unsigned allowed = iv.crosses_call ? callee_saved : all_regs;
+        unsigned taken = 0;
+        for (int a : active) { taken |= 1u << assigned[a]; }
+        for (int a : inactive) {
+            if (!(taken >> assigned[a] & 1) && intervals[a].intersects(iv)) { taken |= 1u << assigned[a]; }
+        }
+        unsigned free = allowed & ~taken;
+
+        int wanted = iv.hint >= 0 ? assigned[find_leader(iv.hint)] : iv.pref;
+        if (wanted >= 0 && (free >> wanted & 1)) {
+            assigned[cur] = wanted;
+        }
+        else if (free) {
+            assigned[cur] = __builtin_ctz(free);
+        }
+        else {
+            // no free register: take the one whose conflicting intervals
+            // are cheapest, if together they are cheaper than this one
+            long cost[NUM_ALLOC_REGS] = {};
+            for (int a : active) { cost[assigned[a]] += intervals[a].weight; }
+            for (int a : inactive) {
+                if (intervals[a].intersects(iv)) { cost[assigned[a]] += intervals[a].weight; }
+            }
+            int best = -1;
+            long best_cost = iv.weight;
+            for (int r = 0; r < NUM_ALLOC_REGS; ++r) {
+                if ((allowed >> r & 1) && cost[r] < best_cost) {
+                    best = r;
+                    best_cost = cost[r];
+                }
+            }
+            if (best < 0) { continue; }
+
+            auto evict = [&](int a) {
+                if (assigned[a] != best || (!intervals[a].covers(pos) && !intervals[a].intersects(iv))) { return false; }
+                assigned[a] = -1;
+                return true;
+            };
+            active.erase(std::remove_if(active.begin(), active.end(), evict), active.end());
+            inactive.erase(std::remove_if(inactive.begin(), inactive.end(), evict), inactive.end());
+            assigned[cur] = best;
+        }
+        active.push_back(cur);
+    }
+
+    reg.assign(intervals.size(), "");
+    unsigned used = 0;
+    for (int v = 0; v < (int)intervals.size(); ++v) {
+        int r = assigned[find_leader(v)];
+        if (r < 0) { continue; }
+        reg[v] = ALLOC_REGS[r];
+        used |= 1u << r;
+    }
+    for (int r = NUM_CALLER_SAVED; r < NUM_ALLOC_REGS; ++r) {
+        if (used >> r & 1) { saved.push_back(ALLOC_REGS[r]); }
+    }
+};
+
+// From rbp down: saved registers, spill slots, then the
+// static arrays with element 0 lowest
+void X86Gen::layout_frame() {
+    int offset = 0;
+    for (int i = 0; i < (int)saved.size(); ++i) {
+        offset += 8;
+        saved_offset.push_back(offset);
+    }
+
+    slot.assign(intervals.size(), 0);
+    for (int v = 0; v < (int)intervals.size(); ++v) {
+        if (!intervals[v].ranges.empty() && reg[v].empty() && find_leader(v) == v) { slot[v] = offset += 8; }
+    }
+    for (int v = 0; v < (int)intervals.size(); ++v) {
+        if (!slot[v]) { slot[v] = slot[find_leader(v)]; }
+    }
+
+    for (auto& arr : func->arrays) { arr_offset.push_back(offset += 8 * std::max(arr.size, 1)); }
+    frame = (offset + 15) / 16 * 16;
+};
+
+void X86Gen::put(const std::string& op, std::vector<std::string> args) {
+    code.push_back({op, std::move(args)});
+};
+
+std::string X86Gen::label(BasicBlock* bb) {
+    return ".L" + func->name + "_" + std::to_string(bb->id);
+};
+
+bool X86Gen::in_mem(const Operand& opnd) {
+    return opnd.is_vreg() && reg[opnd.val].empty();
+};
+
+std::string X86Gen::loc(int vreg) {
+    if (!reg[vreg].empty()) { return reg[vreg]; }
+    return "QWORD PTR [rbp-" + std::to_string(slot[vreg]) + "]";
+};
+
+// Operand usable as the source of an ALU instruction; immediates that do
+// not fit in 32 bits go through scratch
+std::string X86Gen::src(const Operand& opnd, const char* scratch) {
+    if (opnd.is_imm()) {
+        if (fits_imm32(opnd.val)) { return std::to_string(opnd.val); }
+        put("mov", {scratch, std::to_string(opnd.val)});
+        return scratch;
+    }
+    return loc(opnd.val);
+};
+
+void X86Gen::load(const std::string& dst_reg, const Operand& opnd) {
+    if (opnd.is_imm()) {
+        put("mov", {dst_reg, std::to_string(opnd.val)});
+    }
+    else if (loc(opnd.val) != dst_reg) {
+        put("mov", {dst_reg, loc(opnd.val)});
+    }
+};
+
+void X86Gen::store(int dst, const std::string& src_reg) {
+    if (loc(dst) != src_reg) { put("mov", {loc(dst), src_reg}); }
+};
+
+void X86Gen::move_to(int dst, const Operand& opnd) {
+    if (!reg[dst].empty()) {
+        load(reg[dst], opnd);
+    }
+    else if ((opnd.is_imm() && fits_imm32(opnd.val)) || (opnd.is_vreg() && !in_mem(opnd))) {
+        put("mov", {loc(dst), src(opnd, "rax")});
+    }
+    else if (!(opnd.is_vreg() && loc(opnd.val) == loc(dst))) {
+        load("rax", opnd);
+        store(dst, "rax");
+    }
+};
+
+// Memory operand of element idx of an array; uses rcx for an index and rdx
+// for a base that are not in registers
+std::string X86Gen::elem_addr(const Operand& base, const Operand& idx) {
+    std::string idx_reg;
+    if (idx.is_vreg()) {
+        idx_reg = loc(idx.val);
+        if (in_mem(idx)) {
+            put("mov", {"rcx", idx_reg});
+            idx_reg = "rcx";
+        }
+    }
+    // constant indices go into the displacement while it stays 32-bit
+    else if (idx.val > (1 << 27) || idx.val < -(1 << 27)) {
+        load("rcx", idx);
+        idx_reg = "rcx";
+    }
+
+    std::string base_reg = "rbp";
+    long disp = 0;
+    if (base.is_arr()) {
+        disp = -(long)arr_offset[base.val];
+    }
+    else if (base.is_vreg() && !in_mem(base)) {
+        base_reg = reg[base.val];
+    }
+    else {
+        load("rdx", base);
+        base_reg = "rdx";
+    }
+
+    if (idx_reg.empty()) { disp += 8 * idx.val; }
+    std::string addr = "QWORD PTR [" + base_reg;
+    if (!idx_reg.empty()) { addr += "+" + idx_reg + "*8"; }
+    if (disp > 0) { addr += "+" + std::to_string(disp); }
+    if (disp < 0) { addr += std::to_string(disp); }
+    return addr + "]";
+};
+
+// Sets the flags for a cc b and returns the condition to test them with
+Tag X86Gen::emit_cmp(Operand a, Operand b, Tag cc) {
+    if (a.is_imm() && !b.is_imm()) {
+        std::swap(a, b);
+        cc = swap_cc(cc);
+    }
+
+    std::string left;
+    if (a.is_imm() || (in_mem(a) && in_mem(b))) {
+        load("rax", a);
+        left = "rax";
+    }
+    else {
+        left = loc(a.val);
+    }
+    std::string right = src(b, "rcx");
+    put("cmp", {left, right});
+    return cc;
+};
+
+void X86Gen::emit_alu(IRInst& inst) {
+    Operand a = inst.args[0];
+    Operand b = inst.args[1];
+    const std::string& d = reg[inst.dst];
+    auto in_dst = [&](const Operand& opnd) { return opnd.is_vreg() && !d.empty() && reg[opnd.val] == d; };
+
+    // two-address form: the left operand goes into the target first, so
+    // the right one must not live there
+    if (inst.op != _IR_SUB_ && (in_dst(b) || (a.is_imm() && !b.is_imm()))) { std::swap(a, b); }
+    std::string target = (d.empty() || in_dst(b)) ? "rax" : d;
+
+    if (inst.op == _IR_MUL_ && b.is_imm()) {
+        emit_mul_imm(target, a, b.val);
+    }
+    else {
+        load(target, a);
+        const char* mnemonic = "add";
+        switch (inst.op) {
+            case _IR_SUB_ : mnemonic = "sub"; break;
+            case _IR_MUL_ : mnemonic = "imul"; break;
+            case _IR_AND_ : mnemonic = "and"; break;
+            case _IR_OR_ : mnemonic = "or"; break;
+            default : break;
+        }
+        std::string right = src(b, "rcx");
+        put(mnemonic, {target, right});
+    }
+    store(inst.dst, target);
+};
+
+// target = a * c with shifts and lea where they do, imul otherwise
+void X86Gen::emit_mul_imm(const std::string& target, const Operand& a, int64_t c) {
+    uint64_t ac = c < 0 ? 0 - (uint64_t)c : c;
+    if (c == 0) {
+        put("mov", {target, "0"});
+        return;
+    }
+
+    // c = +-2^k or +-(2 or 4 or 8 + 1) * 2^k
+    int k = __builtin_ctzll(ac);
+    uint64_t odd = ac >> k;
+    if (odd == 1 || odd == 3 || odd == 5 || odd == 9) {
+        std::string base = target;
+        if (odd != 1 && a.is_vreg() && !in_mem(a)) { base = loc(a.val); }
+        else { load(target, a); }
+        if (odd != 1) { put("lea", {target, "[" + base + "+" + base + "*" + std::to_string(odd - 1) + "]"}); }
+        if (k) { put("shl", {target, std::to_string(k)}); }
+        if (c < 0) { put("neg", {target}); }
+        return;
+    }
+
+    if (fits_imm32(c)) {
+        // the three-operand form reads a straight from where it lives
+        std::string left = target;
+        if (a.is_imm()) { load(target, a); }
+        else { left = loc(a.val); }
+        put("imul", {target, left, std::to_string(c)});
+        return;
+    }
+    load(target, a);
+    put("mov", {"rcx", std::to_string(c)});
+    put("imul", {target, "rcx"});
+};
+
+// Division and remainder by a constant avoid idiv: powers of two round
+// towards zero with a bias and shift, other divisors multiply by a magic
+// reciprocal and keep the high half. Zero is left to idiv so it still
+// traps.
+void X86Gen::emit_div(IRInst& inst) {
+    const Operand& a = inst.args[0];
+    const Operand& b = inst.args[1];
+    bool rem = inst.op == _IR_MOD_;
+
+    // dividing INT64_MIN by -1 traps, as it does for an unknown divisor
+    if (!b.is_imm() || b.val == 0 || b.val == -1) {
+        load("rax", a);
+        put("cqo");
+        if (b.is_imm()) {
+            load("rcx", b);
+            put("idiv", {"rcx"});
+        }
+        else {
+            put("idiv", {loc(b.val)});
+        }
+        store(inst.dst, rem ? "rdx" : "rax");
+        return;
+    }
+
+    int64_t d = b.val;
+    if (d == 1) {
+        move_to(inst.dst, rem ? Operand::imm(0) : a);
+        return;
+    }
+
+    // a has to stay readable after rax and rdx are taken
+    std::string x = a.is_imm() ? "rcx" : loc(a.val);
+    if (a.is_imm()) { load("rcx", a); }
+
+    int k = log2_exact(d < 0 ? 0 - (uint64_t)d : d);
+    if (k > 0) {
+        // negative dividends get 2^k - 1 added so the shift truncates
+        put("mov", {"rax", x});
+        put("mov", {"rdx", "rax"});
+        if (k > 1) { put("sar", {"rdx", "63"}); }
+        put("shr", {"rdx", std::to_string(64 - k)});
+        put("add", {"rax", "rdx"});
+        if (!rem) {
+            put("sar", {"rax", std::to_string(k)});
+            if (d < 0) { put("neg", {"rax"}); }
+            store(inst.dst, "rax");
+            return;
+        }
+        // a - (a rounded towards zero to a multiple of 2^k)
+        if (k < 32) {
+            put("and", {"rax", std::to_string(-(1LL << k))});
+        }
+        else {
+            put("sar", {"rax", std::to_string(k)});
+            put("shl", {"rax", std::to_string(k)});
+        }
+        put("neg", {"rax"});
+        put("add", {"rax", x});
+        store(inst.dst, "rax");
+        return;
+    }
+
+    int64_t mult;
+    int shift;
+    signed_magic(d, mult, shift);
+    put("mov", {"rax", std::to_string(mult)});
+    put("imul", {x});
+    if (d > 0 && mult < 0) { put("add", {"rdx", x}); }
+    if (d < 0 && mult > 0) { put("sub", {"rdx", x}); }
+    if (shift) { put("sar", {"rdx", std::to_string(shift)}); }
+    // round towards zero
+    put("mov", {"rax", "rdx"});
+    put("shr", {"rax", "63"});
+    put("add", {"rdx", "rax"});
+    if (!rem) {
+        store(inst.dst, "rdx");
+        return;
+    }
+    if (fits_imm32(d)) {
+        put("imul", {"rdx", "rdx", std::to_string(d)});
+    }
+    else {
+        put("mov", {"rax", std::to_string(d)});
+        put("imul", {"rdx", "rax"});
+    }
+    std::string target = reg[inst.dst].empty() ? "rax" : reg[inst.dst];
+    if (target != x) { put("mov", {target, x}); }
+    put("sub", {target, "rdx"});
+    store(inst.dst, target);
+};
+
+// The hardware masks the count to six bits, as the language does
+void X86Gen::emit_shift(IRInst& inst) {
+    const Operand& a = inst.args[0];
+    const Operand& b = inst.args[1];
+    const char* mnemonic = inst.op == _IR_SHL_ ? "shl" : "sar";
+    std::string target = reg[inst.dst].empty() ? "rax" : reg[inst.dst];
+
+    if (b.is_imm()) {
+        load(target, a);
+        if (b.val & 63) { put(mnemonic, {target, std::to_string(b.val & 63)}); }
+    }
+    else {
+        // the count may sit in target, so it moves out first
+        load("rcx", b);
+        load(target, a);
+        put(mnemonic, {target, "cl"});
+    }
+    store(inst.dst, target);
+};
+
+// Vector registers are xmm0 to xmm12 (ymm with AVX2), xmm13 to xmm15 are
+// scratch. rax holds the index, rdx the end and r11 a base that is not in
+// a register.
+void X86Gen::emit_vloop(IRInst& inst) {
+    VecLoop* vec = inst.vec;
+    bool avx = vec->isa == _SIMD_AVX2_;
+    const int T1 = 13, T2 = 14, T3 = 15;
+    auto wide = [&](int v) { return (avx ? "ymm" : "xmm") + std::to_string(v); };
+    auto xmm = [](int v) { return "xmm" + std::to_string(v); };
+    auto move = [&](int dst, int a) {
+        if (dst != a) { put(avx ? "vmovdqa" : "movdqa", {wide(dst), wide(a)}); }
+    };
+    // dst = a op b; without AVX's three operand forms that takes a copy
+    // of a into dst, and of b first if dst is b
+    auto op3 = [&](const char* op, int dst, int a, int b) {
+        if (avx) {
+            put(std::string("v") + op, {wide(dst), wide(a), wide(b)});
+            return;
+        }
+        if (dst == b && dst != a) {
+            put("movdqa", {xmm(T3), xmm(b)});
+            b = T3;
+        }
+        move(dst, a);
+        put(op, {xmm(dst), xmm(b)});
+    };
+    auto shift = [&](const char* op, int dst, int a, int count) {
+        if (avx) {
+            put(std::string("v") + op, {wide(dst), wide(a), std::to_string(count)});
+            return;
+        }
+        move(dst, a);
+        put(op, {xmm(dst), std::to_string(count)});
+    };
+    auto addr = [&](int arg) {
+        const Operand& base = inst.args[arg];
+        std::string mem = avx ? "YMMWORD PTR [" : "XMMWORD PTR [";
+        if (base.is_arr()) { return mem + "rbp+rax*8-" + std::to_string(arr_offset[base.val]) + "]"; }
+        if (!in_mem(base)) { return mem + reg[base.val] + "+rax*8]"; }
+        put("mov", {"r11", loc(base.val)});
+        return mem + "r11+rax*8]";
+    };
+    // register holding a constant that fits in 32 unsigned bits
+    auto small = [&](int r) {
+        for (auto& splat : vec->splats) {
+            const Operand& opnd = inst.args[splat.second];
+            if (splat.first == r) { return opnd.is_imm() && opnd.val >= 0 && opnd.val <= UINT32_MAX; }
+        }
+        return false;
+    };
+    const char* reduce = vec->reduce == _IR_AND_ ? "pand" : vec->reduce == _IR_OR_ ? "por" : "paddq";
+
+    for (auto& splat : vec->splats) {
+        const Operand& opnd = inst.args[splat.second];
+        if (opnd.is_imm() && opnd.val == 0) {
+            op3("pxor", splat.first, splat.first, splat.first);
+            continue;
+        }
+        load("rcx", opnd);
+        put(avx ? "vmovq" : "movq", {xmm(splat.first), "rcx"});
+        if (avx) { put("vpbroadcastq", {wide(splat.first), xmm(splat.first)}); }
+        else { put("punpcklqdq", {xmm(splat.first), xmm(splat.first)}); }
+    }
+    load("rdx", inst.args[1]);
+    load("rax", inst.args[0]);
+    if (vec->index >= 0) {
+        int index = vec->index;
+        put(avx ? "vmovq" : "movq", {xmm(index), "rax"});
+        put("lea", {"rcx", "[rax+1]"});
+        if (avx) {
+            put("vpinsrq", {xmm(index), xmm(index), "rcx", "1"});
+            put("lea", {"rcx", "[rax+2]"});
+            put("vmovq", {xmm(T1), "rcx"});
+            put("lea", {"rcx", "[rax+3]"});
+            put("vpinsrq", {xmm(T1), xmm(T1), "rcx", "1"});
+            put("vinserti128", {wide(index), wide(index), xmm(T1), "1"});
+        }
+        else {
+            put("pinsrq", {xmm(index), "rcx", "1"});
+        }
+    }
+    if (vec->acc >= 0) { op3(vec->reduce == _IR_AND_ ? "pcmpeqd" : "pxor", vec->acc, vec->acc, vec->acc); }
+
+    std::string top = ".L" + func->name + "_v" + std::to_string(num_vloops++);
+    code.push_back({top, {}, true});
+    for (auto& op : vec->body) {
+        switch (op.op) {
+            case _IR_LOAD_ : put(avx ? "vmovdqu" : "movdqu", {wide(op.dst), addr(op.a)}); break;
+            case _IR_STORE_ : put(avx ? "vmovdqu" : "movdqu", {addr(op.a), wide(op.b)}); break;
+            case _IR_COPY_ : move(op.dst, op.a); break;
+            case _IR_ADD_ : op3("paddq", op.dst, op.a, op.b); break;
+            case _IR_SUB_ : op3("psubq", op.dst, op.a, op.b); break;
+            case _IR_AND_ : op3("pand", op.dst, op.a, op.b); break;
+            case _IR_OR_ : op3("por", op.dst, op.a, op.b); break;
+            case _IR_SHL_ : {
+                if (op.b) { shift("psllq", op.dst, op.a, op.b); }
+                else { move(op.dst, op.a); }
+                break;
+            }
+            case _IR_NOT_ : {
+                op3("pcmpeqd", T1, T1, T1);
+                op3("pxor", op.dst, op.a, T1);
+                break;
+            }
+            case _IR_NEG_ : {
+                op3("pxor", T1, T1, T1);
+                op3("psubq", op.dst, T1, op.a);
+                break;
+            }
+            case _IR_MUL_ : {
+                // the low 64 bits of a * b out of 32-bit halves:
+                // lo(a) * lo(b) + ((hi(a) * lo(b) + lo(a) * hi(b)) << 32),
+                // the last product dropping out for a constant b below 2^32
+                int a = small(op.a) ? op.b : op.a;
+                int b = small(op.a) ? op.a : op.b;
+                shift("psrlq", T1, a, 32);
+                op3("pmuludq", T1, T1, b);
+                if (!small(b)) {
+                    shift("psrlq", T2, b, 32);
+                    op3("pmuludq", T2, T2, a);
+                    op3("paddq", T1, T1, T2);
+                }
+                shift("psllq", T1, T1, 32);
+                op3("pmuludq", T2, a, b);
+                op3("paddq", op.dst, T1, T2);
+                break;
+            }
+            case _IR_CMP_ : {
+                // lanes come out all ones or zero; the shift makes that 1 or
+                // 0, adding 1 makes it 0 or 1 for the negated conditions
+                bool swapped = op.cc == _LESS_ || op.cc == _GEQ_;
+                bool negated = op.cc == _NEQ_ || op.cc == _LEQ_ || op.cc == _GEQ_;
+                const char* cmp = op.cc == _EQ_ || op.cc == _NEQ_ ? "pcmpeqq" : "pcmpgtq";
+                op3(cmp, op.dst, swapped ? op.b : op.a, swapped ? op.a : op.b);
+                if (negated) {
+                    op3("pcmpeqd", T1, T1, T1);
+                    shift("psrlq", T1, T1, 63);
+                    op3("paddq", op.dst, op.dst, T1);
+                }
+                else {
+                    shift("psrlq", op.dst, op.dst, 63);
+                }
+                break;
+            }
+            default : break;
+        }
+    }
+    put("add", {"rax", avx ? "4" : "2"});
+    put("cmp", {"rax", "rdx"});
+    put("jl", {top});
+
+    if (vec->acc >= 0) {
+        int acc = vec->acc;
+        if (avx) {
+            put("vextracti128", {xmm(T1), wide(acc), "1"});
+            put(std::string("v") + reduce, {xmm(acc), xmm(acc), xmm(T1)});
+            put("vpshufd", {xmm(T1), xmm(acc), "0x4e"});
+            put(std::string("v") + reduce, {xmm(acc), xmm(acc), xmm(T1)});
+            put("vmovq", {"rcx", xmm(acc)});
+        }
+        else {
+            put("pshufd", {xmm(T1), xmm(acc), "0x4e"});
+            put(reduce, {xmm(acc), xmm(T1)});
+            put("movq", {"rcx", xmm(acc)});
+        }
+        load("rax", inst.args[2]);
+        put(vec->reduce == _IR_AND_ ? "and" : vec->reduce == _IR_OR_ ? "or" : "add", {"rax", "rcx"});
+        store(inst.dst, "rax");
+    }
+    // dirty upper halves would slow down SSE code in the C library
+    if (avx) { put("vzeroupper"); }
+};
+
+std::vector<Move> X86Gen::arg_moves(const std::vector<Operand>& args, int first) {
+    std::vector<Move> moves;
+    for (int i = 0; i < (int)args.size() && first + i < NUM_ARG_REGS; ++i) {
+        const Operand& arg = args[i];
+        if (arg.is_arr()) { moves.push_back({ARG_REGS[first + i], "[rbp-" + std::to_string(arr_offset[arg.val]) + "]", true}); }
+        else { moves.push_back({ARG_REGS[first + i], arg.is_imm() ? std::to_string(arg.val) : loc(arg.val), false}); }
+    }
+    return moves;
+};
+
+// Arguments past the registers are pushed last to first, so the first of
+// them ends up lowest, under a padding word when their count is odd.
+// Returns the bytes to take off rsp after the call.
+int X86Gen::push_stack_args(const std::vector<Operand>& args) {
+    int n = std::max((int)args.size() - NUM_ARG_REGS, 0);
+    if (n % 2) { put("sub", {"rsp", "8"}); }
+    for (int i = (int)args.size() - 1; i >= NUM_ARG_REGS; --i) {
+        const Operand& arg = args[i];
+        if (arg.is_arr()) {
+            put("lea", {"rax", "[rbp-" + std::to_string(arr_offset[arg.val]) + "]"});
+            put("push", {"rax"});
+        }
+        else { put("push", {src(arg, "rax")}); }
+    }
+    return 8 * (n + n % 2);
+};
+
+// A few elements are stored one by one, more two at a time from xmm15
+// counting down from the top, an odd last one stored first
+void X86Gen::emit_fill(IRInst& inst) {
+    int64_t n = inst.args[1].val;
+    int off = arr_offset[inst.args[0].val];
+    auto elem = [&](int64_t i) { return "QWORD PTR [rbp-" + std::to_string(off - 8 * i) + "]"; };
+    if (n <= 0) { return; }
+
+    std::string val = "rax";
+    if (n <= 4 && !in_mem(inst.args[2])) { val = src(inst.args[2], "rax"); }
+    else { load("rax", inst.args[2]); }
+    if (n <= 4) {
+        for (int64_t i = 0; i < n; ++i) { put("mov", {elem(i), val}); }
+        return;
+    }
+
+    if (n % 2) { put("mov", {elem(n - 1), "rax"}); }
+    put("movq", {"xmm15", "rax"});
+    put("punpcklqdq", {"xmm15", "xmm15"});
+    put("lea", {"r11", "[rbp-" + std::to_string(off) + "]"});
+    put("mov", {"rcx", std::to_string(n / 2 * 2)});
+    std::string top = ".L" + func->name + "_f" + std::to_string(num_fills++);
+    code.push_back({top, {}, true});
+    put("movdqu", {"XMMWORD PTR [r11+rcx*8-16]", "xmm15"});
+    put("sub", {"rcx", "2"});
+    put("jnz", {top});
+};
+
+// Unsigned, so a negative index fails as well. A dynamic array keeps its
+// length in the word two before element 0.
+void X86Gen::emit_check(IRInst& inst) {
+    const Operand& base = inst.args[0];
+    const Operand& idx = inst.args[1];
+    std::string fail = ".L" + func->name + "_b" + std::to_string(failed_checks.size());
+    std::string jump = inst.cc == _LEQ_ ? "ja" : "jae";
+
+    std::string len;
+    if (base.is_arr()) {
+        int size = func->arrays[base.val].size;
+        if (idx.is_imm()) {
+            bool holds = inst.cc == _LEQ_ ? (uint64_t)idx.val <= (uint64_t)size : (uint64_t)idx.val < (uint64_t)size;
+            if (holds) { return; }
+            put("jmp", {fail});
+            failed_checks.push_back({fail, &inst});
+            return;
+        }
+        len = std::to_string(size);
+    }
+    else {
+        std::string base_reg = in_mem(base) ? "rdx" : reg[base.val];
+        load(base_reg, base);
+        len = "QWORD PTR [" + base_reg + "-16]";
+    }
+
+    std::string at = idx.is_imm() ? "" : loc(idx.val);
+    if (idx.is_imm() || (in_mem(idx) && !base.is_arr())) {
+        load("rcx", idx);
+        at = "rcx";
+    }
+    put("cmp", {at, len});
+    put(jump, {fail});
+    failed_checks.push_back({fail, &inst});
+};
+
+// Reports the line, the index and the length; each check jumps here with
+// everything still where it was
+void X86Gen::emit_check_failures() {
+    for (auto& failed : failed_checks) {
+        const IRInst& inst = *failed.second;
+        code.push_back({failed.first, {}, true});
+        if (inst.args[0].is_arr()) {
+            put("mov", {"rax", std::to_string(func->arrays[inst.args[0].val].size)});
+        }
+        else {
+            load("rax", inst.args[0]);
+            put("mov", {"rax", "QWORD PTR [rax-16]"});
+        }
+        std::vector<Move> moves = arg_moves({inst.args[2], inst.args[1]}, 0);
+        moves.push_back({"rdx", "rax", false});
+        emit_call("bounds_fail", moves, -1, false);
+    }
+};
+
+// Nothing live across a call sits in a caller-saved register and the frame
+// keeps rsp 16-byte aligned, so a call is just its argument moves, after
+// whatever went on the stack
+void X86Gen::emit_call(const std::string& name, std::vector<Move> moves, int dst, bool varargs, int stack) {
+    parallel_move(code, moves);
+    if (varargs) { put("xor", {"rax", "rax"}); }
+    put("call", {name});
+    if (stack) { put("add", {"rsp", std::to_string(stack)}); }
+    if (dst >= 0) { store(dst, "rax"); }
+};
+
+// Returns, or with a target jumps there in its place
+void X86Gen::emit_epilogue(const std::string& target) {
+    for (int i = 0; i < (int)saved.size(); ++i) {
+        put("mov", {saved[i], "QWORD PTR [rbp-" + std::to_string(saved_offset[i]) + "]"});
+    }
+    put("leave");
+    if (target.empty()) { put("ret"); }
+    else { put("jmp", {target}); }
+};
+
+// A call at insts[k] whose result the block returns right away can leave
+// our frame first and jump, the callee returning to our caller. That
+// needs every argument in a register and none pointing into our frame.
+bool X86Gen::is_tail_call(BasicBlock* bb, int k) {
+    const IRInst& call = bb->insts[k];
+    const IRInst& ret = bb->insts.back();
+    if (call.op != _IR_CALL_ || k + 2 != (int)bb->insts.size() || ret.op != _IR_RET_ || ret.args[0] != Operand::vreg(call.dst)) { return false; }
+    if ((int)call.args.size() > NUM_ARG_REGS) { return false; }
+    return std::none_of(call.args.begin(), call.args.end(), [](const Operand& arg) { return arg.is_arr(); });
+};
+
+void X86Gen::emit_inst(IRInst& inst, BasicBlock* bb, BasicBlock* next) {
+    switch (inst.op) {
+        case _IR_CONST_ :
+        case _IR_COPY_ : {
+            move_to(inst.dst, inst.args[0]);
+            break;
+        }
+        case _IR_ADD_ :
+        case _IR_SUB_ :
+        case _IR_MUL_ :
+        case _IR_AND_ :
+        case _IR_OR_ : {
+            emit_alu(inst);
+            break;
+        }
+        case _IR_DIV_ :
+        case _IR_MOD_ : {
+            emit_div(inst);
+            break;
+        }
+        case _IR_SHL_ :
+        case _IR_SHR_ : {
+            emit_shift(inst);
+            break;
+        }
+        case _IR_NOT_ :
+        case _IR_NEG_ : {
+            std::string target = reg[inst.dst].empty() ? "rax" : reg[inst.dst];
+            load(target, inst.args[0]);
+            put(inst.op == _IR_NOT_ ? "not" : "neg", {target});
+            store(inst.dst, target);
+            break;
+        }
+        case _IR_CMP_ : {
+            Tag cc = emit_cmp(inst.args[0], inst.args[1], inst.cc);
+            put(std::string("set") + cond_code(cc), {"al"});
+            put("movzx", {"eax", "al"});
+            store(inst.dst, "rax");
+            break;
+        }
+        case _IR_LOAD_ : {
+            std::string target = reg[inst.dst].empty() ? "rax" : reg[inst.dst];
+            std::string addr = elem_addr(inst.args[0], inst.args[1]);
+            put("mov", {target, addr});
+            store(inst.dst, target);
+            break;
+        }
+        case _IR_STORE_ : {
+            const Operand& val = inst.args[2];
+            std::string val_src;
+            if ((val.is_imm() && fits_imm32(val.val)) || (val.is_vreg() && !in_mem(val))) {
+                val_src = src(val, "rax");
+            }
+            else {
+                load("rax", val);
+                val_src = "rax";
+            }
+            std::string addr = elem_addr(inst.args[0], inst.args[1]);
+            put("mov", {addr, val_src});
+            break;
+        }
+        case _IR_SIMD_ : {
+            std::string target = reg[inst.dst].empty() ? "rax" : reg[inst.dst];
+            put("mov", {target, "QWORD PTR simd_level[rip]"});
+            store(inst.dst, target);
+            break;
+        }
+        case _IR_VLOOP_ : {
+            emit_vloop(inst);
+            break;
+        }
+        case _IR_ALLOC_ : {
+            emit_call("dyn_malloc", arg_moves(inst.args, 0), inst.dst, false);
+            break;
+        }
+        case _IR_FILL_ : {
+            emit_fill(inst);
+            break;
+        }
+        case _IR_CHECK_ : {
+            emit_check(inst);
+            break;
+        }
+        case _IR_FREE_ : {
+            emit_call("dyn_free", arg_moves(inst.args, 0), -1, false);
+            break;
+        }
+        case _IR_CALL_ : {
+            int stack = push_stack_args(inst.args);
+            emit_call(inst.func, arg_moves(inst.args, 0), inst.dst, false, stack);
+            break;
+        }
+        case _IR_PRINT_ : {
+            emit_call("print_int", arg_moves(inst.args, 0), -1, false);
+            break;
+        }
+        case _IR_SCAN_ : {
+            emit_call("scan_int", {}, inst.dst, false);
+            break;
+        }
+        case _IR_PRINT_ARR_ : {
+            emit_call("print_array", arg_moves(inst.args, 0), -1, false);
+            break;
+        }
+        case _IR_SCAN_ARR_ : {
+            emit_call("scan_array", arg_moves(inst.args, 0), -1, false);
+            break;
+        }
+        case _IR_JMP_ : {
+            if (bb->succs[0] != next) { put("jmp", {label(bb->succs[0])}); }
+            break;
+        }
+        case _IR_BR_ : {
+            Tag cc = emit_cmp(inst.args[0], inst.args[1], inst.cc);
+            BasicBlock* taken = bb->succs[0];
+            BasicBlock* other = bb->succs[1];
+            if (taken == next) {
+                put(std::string("j") + cond_code(negate_cc(cc)), {label(other)});
+            }
+            else {
+                put(std::string("j") + cond_code(cc), {label(taken)});
+                if (other != next) { put("jmp", {label(other)}); }
+            }
+            break;
+        }
+        case _IR_RET_ : {
+            load("rax", inst.args[0]);
+            emit_epilogue();
+            break;
+        }
+        default : break;
+    }
+};
+
+void X86Gen::run(bool optimize) {
+    build_intervals();
+    coalesce();
+    allocate();
+    layout_frame();
+
+    put("push", {"rbp"});
+    put("mov", {"rbp", "rsp"});
+    if (frame) { put("sub", {"rsp", std::to_string(frame)}); }
+    for (int i = 0; i < (int)saved.size(); ++i) {
+        put("mov", {"QWORD PTR [rbp-" + std::to_string(saved_offset[i]) + "]", saved[i]});
+    }
+
+    // every parameter leaves its argument register at once, then the rest
+    // come from above the return address
+    std::vector<Move> params;
+    std::vector<const IRInst*> stacked;
+    int at = 0;
+    for (auto& inst : func->blocks[0]->insts) {
+        at += 4;
+        // unread before it is assigned again, if at all
+        if (inst.op != _IR_PARAM_ || !intervals[inst.dst].covers(at + 1)) { continue; }
+        if (inst.args[0].val < NUM_ARG_REGS) { params.push_back({loc(inst.dst), ARG_REGS[inst.args[0].val], false}); }
+        else { stacked.push_back(&inst); }
+    }
+    parallel_move(code, params);
+    for (auto* inst : stacked) {
+        std::string target = reg[inst->dst].empty() ? "rax" : reg[inst->dst];
+        put("mov", {target, "QWORD PTR [rbp+" + std::to_string(16 + 8 * (inst->args[0].val - NUM_ARG_REGS)) + "]"});
+        store(inst->dst, target);
+    }
+
+    for (int i = 0; i < (int)func->blocks.size(); ++i) {
+        BasicBlock* bb = func->blocks[i];
+        BasicBlock* next = i + 1 < (int)func->blocks.size() ? func->blocks[i + 1] : nullptr;
+        if (!bb->preds.empty()) { code.push_back({label(bb), {}, true}); }
+        for (int k = 0; k < (int)bb->insts.size(); ++k) {
+            if (optimize && is_tail_call(bb, k)) {
+                IRInst& call = bb->insts[k];
+                parallel_move(code, arg_moves(call.args, 0));
+                emit_epilogue(call.func);
+                break;
+            }
+            emit_inst(bb->insts[k], bb, next);
+        }
+    }
+    emit_check_failures();
+    if (optimize) { run_peephole(code); }
+
+    asm_out << func->name << ":" << '\n';
+    for (auto& line : code) {
+        if (line.is_label) {
+            asm_out << line.op << ":" << '\n';
+            continue;
+        }
+        if (line.op.empty()) { continue; }
+        asm_out << "  " << line.op;
+        for (int i = 0; i < (int)line.args.size(); ++i) { asm_out << (i ? ", " : " ") << line.args[i]; }
+        asm_out << '\n';
+    }
+    asm_out << '\n';
+};
+
+void emit_module(IRModule* mod, bool optimize) {
+    asm_out.section(_HEADER_SEC_);
+    asm_out << ".intel_syntax noprefix\n" << '\n';
+
+    asm_out.section(_DATA_SEC_);
+    asm_out << ".data" << '\n';
+
+    asm_out.section(_TEXT_SEC_);
+    asm_out << "\n.text\n" << '\n';
+    asm_out << ".global main" << '\n';
+
+    for (auto* func : mod->funcs) { X86Gen(func).run(optimize); }
+};
@@ -0,0 +1,12 @@
+#include "../ir/ir.hpp"
+
+#ifndef X86_HPP
+#define X86_HPP
+
+// Lowers every function of mod to x86-64 assembly (Intel syntax) into
+// asm_out. Functions must be out of SSA form. With optimize set, calls
+// whose result is returned right away become jumps and every function
+// goes through the peephole rules before it is written.
+void emit_module(IRModule* mod, bool optimize);
+
+#endif
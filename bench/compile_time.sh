@@ -0,0 +1,26 @@
+#!/bin/bash
+# Usage: bench/compile_time.sh compiler [compiler...]
+# Compiles the program gen_program.py writes with each compiler given and
+# prints the best of 3 wall-clock times.
+
+if [[ $# == 0 ]]; then
+    echo "usage: $0 compiler [compiler...]"
+    exit 1
+fi
+
+prog=$(mktemp --suffix=.exp)
+trap 'rm -f "$prog"' EXIT
+python3 "$(dirname "$0")/gen_program.py" > "$prog"
+echo "[INFO] $(wc -l < "$prog") lines, $(wc -c < "$prog") bytes"
+
+TIMEFORMAT=%R
+for compiler in "$@"; do
+    best=""
+    for run in 1 2 3; do
+        t=$( { time "$compiler" "$prog" > /dev/null 2>&1; } 2>&1 )
+        if [[ -z $best ]] || awk "BEGIN { exit !($t < $best) }"; then
+            best=$t
+        fi
+    done
+    echo "$compiler: ${best}s"
+done
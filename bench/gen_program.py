@@ -0,0 +1,20 @@
+# Writes a large straight-line program for timing the compiler itself:
+# 3000 statements of deep arithmetic over four variables, with a small
+# while loop every tenth statement. Same seed, same program.
+import random
+import sys
+
+R = random.Random(int(sys.argv[1]) if len(sys.argv) > 1 else 7)
+N = int(sys.argv[2]) if len(sys.argv) > 2 else 3000
+
+def expr(d):
+    if d > 5 or R.random() < 0.2:
+        return R.choice(["a", "b", "c", "d", str(R.randint(1, 9))])
+    return "(%s %s %s)" % (expr(d + 1), R.choice("+-*"), expr(d + 1))
+
+print("a := 1; b := 2; c := 3; d := 4;")
+for i in range(N):
+    if i % 10 == 0:
+        print("while (a < %d) { a := a + 1; b := %s; };" % (i, expr(2)))
+    else:
+        print("%s := %s;" % (R.choice("abcd"), expr(0)))
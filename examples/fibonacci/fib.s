@@ -1,8 +1,6 @@
 .intel_syntax noprefix
 
 .data
-  print_format: .asciz "%ld\n"
-  scan_format: .asciz "%ld"
 
 .text
 
@@ -10,64 +8,38 @@
 main:
   push rbp
   mov rbp, rsp
-  sub rsp, 48
-  mov rax, 0
-  mov QWORD PTR [rbp-8], rax
-  lea rdi, scan_format
-  lea rsi, [rbp-8]
-  xor rax, rax
-  call scanf
-  mov rax, 0
-  mov QWORD PTR [rbp-16], rax
-  mov rax, 1
-  mov QWORD PTR [rbp-24], rax
-  mov rax, 2
-  mov QWORD PTR [rbp-32], rax
-  mov rax, QWORD PTR [rbp-16]
-  lea rdi, print_format
-  mov rsi, rax
-  xor rax, rax
-  call printf
-  mov rax, QWORD PTR [rbp-24]
-  lea rdi, print_format
-  mov rsi, rax
-  xor rax, rax
-  call printf
-loop0:
-  mov rax, QWORD PTR [rbp-32]
-  push rax
-  mov rax, QWORD PTR [rbp-8]
-  push rax
-  pop rbx
-  pop rax
-  mov rdi, rax
-  mov rsi, rbx
-  call cmp_less
-  cmp rax, 0
-  je main0
-  mov rax, QWORD PTR [rbp-16]
-  push rax
-  mov rax, QWORD PTR [rbp-24]
-  pop rbx
-  add rax, rbx
-  mov QWORD PTR [rbp-40], rax
-  mov rax, QWORD PTR [rbp-40]
-  lea rdi, print_format
-  mov rsi, rax
-  xor rax, rax
-  call printf
-  mov rax, QWORD PTR [rbp-24]
-  mov QWORD PTR [rbp-16], rax
-  mov rax, QWORD PTR [rbp-40]
-  mov QWORD PTR [rbp-24], rax
-  mov rax, QWORD PTR [rbp-32]
-  push rax
-  mov rax, 1
-  pop rbx
-  add rax, rbx
-  mov QWORD PTR [rbp-32], rax
-  jmp loop0
-main0:
+  sub rsp, 32
+  mov QWORD PTR [rbp-8], rbx
+  mov QWORD PTR [rbp-16], r12
+  mov QWORD PTR [rbp-24], r13
+  mov QWORD PTR [rbp-32], r14
+  call scan_int
+  mov rbx, rax
+  xor edi, edi
+  call print_int
+  mov rdi, 1
+  call print_int
+  mov r12, 2
+  mov r13, 1
+  xor esi, esi
+  cmp rbx, 2
+  jle .Lmain_2
+.Lmain_1:
+  mov r14, rsi
+  add r14, r13
+  mov rdi, r14
+  call print_int
+  mov rsi, r13
+  add r12, 1
+  mov r13, r14
+  cmp r12, rbx
+  jl .Lmain_1
+.Lmain_2:
+  xor eax, eax
+  mov rbx, QWORD PTR [rbp-8]
+  mov r12, QWORD PTR [rbp-16]
+  mov r13, QWORD PTR [rbp-24]
+  mov r14, QWORD PTR [rbp-32]
   leave
   ret
 
@@ -1,123 +1,55 @@
 .intel_syntax noprefix
 
 .data
-  print_format: .asciz "%ld\n"
-  scan_format: .asciz "%ld"
 
 .text
 
 .global main
-inc:
-  push rbp
-  mov rbp, rsp
-  sub rsp, 8
-  mov QWORD PTR [rbp-8], rdi
-  mov rax, QWORD PTR [rbp-8]
-  push rax
-  mov rax, 1
-  pop rbx
-  add rax, rbx
-  leave
-  ret
-
 main:
   push rbp
   mov rbp, rsp
   sub rsp, 32
-  mov rax, 0
-  mov QWORD PTR [rbp-8], rax
-  lea rdi, scan_format
-  lea rsi, [rbp-8]
-  xor rax, rax
-  call scanf
-  mov rax, QWORD PTR [rbp-8]
-  mov rdi, rax
-  mov rax, 0
-  mov rsi, rax
+  mov QWORD PTR [rbp-8], rbx
+  mov QWORD PTR [rbp-16], r12
+  mov QWORD PTR [rbp-24], r13
+  call scan_int
+  mov rbx, rax
+  mov rdi, rbx
+  xor esi, esi
   call dyn_malloc
-  mov QWORD PTR [rbp-16], rax
-  mov rax, 0
-  mov QWORD PTR [rbp-24], rax
-loop0:
-  mov rax, QWORD PTR [rbp-24]
-  push rax
-  mov rax, QWORD PTR [rbp-8]
-  push rax
-  pop rbx
-  pop rax
-  mov rdi, rax
-  mov rsi, rbx
-  call cmp_less
-  cmp rax, 0
-  je main0
-  mov rdi, QWORD PTR [rbp-16]
-  mov rax, QWORD PTR [rbp-24]
-  mov rsi, rax
-  mov rax, QWORD PTR [rbp-24]
-  mov rdx, rax
-  call set
-  mov rdi, QWORD PTR [rbp-16]
-  mov rax, QWORD PTR [rbp-24]
-  mov rsi, rax
-  call get
-  lea rdi, print_format
-  mov rsi, rax
-  xor rax, rax
-  call printf
-  mov rax, QWORD PTR [rbp-24]
-  push rax
-  mov rax, 1
-  pop rbx
-  add rax, rbx
-  mov QWORD PTR [rbp-24], rax
-  jmp loop0
-main0:
-  mov rax, 0
-  mov QWORD PTR [rbp-24], rax
-loop1:
-  mov rax, QWORD PTR [rbp-24]
-  push rax
-  mov rax, QWORD PTR [rbp-8]
-  push rax
-  pop rbx
-  pop rax
-  mov rdi, rax
-  mov rsi, rbx
-  call cmp_less
-  cmp rax, 0
-  je main1
-  mov rax, QWORD PTR [rbp-24]
-  mov rdi, rax
-  call inc
-  mov QWORD PTR [rbp-24], rax
-  mov rdi, QWORD PTR [rbp-16]
-  mov rax, QWORD PTR [rbp-24]
-  push rax
-  mov rax, 1
-  push rax
-  pop rbx
-  pop rax
-  sub rax, rbx
-  mov rsi, rax
-  mov rax, QWORD PTR [rbp-24]
-  mov rdx, rax
-  call set
-  mov rdi, QWORD PTR [rbp-16]
-  mov rax, QWORD PTR [rbp-24]
-  push rax
-  mov rax, 1
-  push rax
-  pop rbx
-  pop rax
-  sub rax, rbx
-  mov rsi, rax
-  call get
-  lea rdi, print_format
-  mov rsi, rax
-  xor rax, rax
-  call printf
-  jmp loop1
-main1:
+  mov r12, rax
+  xor r13d, r13d
+  test rbx, rbx
+  jle .Lmain_2
+.Lmain_1:
+  mov QWORD PTR [r12+r13*8], r13
+  mov rsi, r13
+  mov rdi, rsi
+  call print_int
+  add r13, 1
+  cmp r13, rbx
+  jl .Lmain_1
+.Lmain_2:
+  xor r13d, r13d
+  test rbx, rbx
+  jle .Lmain_4
+.Lmain_3:
+  add r13, 1
+  mov rsi, r13
+  sub rsi, 1
+  mov QWORD PTR [r12+rsi*8], r13
+  mov rsi, r13
+  sub rsi, 1
+  mov rsi, QWORD PTR [r12+rsi*8]
+  mov rdi, rsi
+  call print_int
+  cmp r13, rbx
+  jl .Lmain_3
+.Lmain_4:
+  xor eax, eax
+  mov rbx, QWORD PTR [rbp-8]
+  mov r12, QWORD PTR [rbp-16]
+  mov r13, QWORD PTR [rbp-24]
   leave
   ret
 
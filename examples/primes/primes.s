@@ -1,8 +1,6 @@
 .intel_syntax noprefix
 
 .data
-  print_format: .asciz "%ld\n"
-  scan_format: .asciz "%ld"
 
 .text
 
@@ -10,119 +8,57 @@
 main:
   push rbp
   mov rbp, rsp
-  sub rsp, 48
-  mov rax, 0
-  mov QWORD PTR [rbp-8], rax
-  lea rdi, scan_format
-  lea rsi, [rbp-8]
-  xor rax, rax
-  call scanf
-  mov rax, 0
-  mov QWORD PTR [rbp-16], rax
-  mov rax, 2
-  mov QWORD PTR [rbp-24], rax
-loop0:
-  mov rax, QWORD PTR [rbp-16]
-  push rax
-  mov rax, QWORD PTR [rbp-8]
-  push rax
-  pop rbx
-  pop rax
-  mov rdi, rax
-  mov rsi, rbx
-  call cmp_less
-  cmp rax, 0
-  je main0
-  mov rax, 2
-  mov QWORD PTR [rbp-32], rax
-  mov rax, 0
-  mov QWORD PTR [rbp-40], rax
-loop1:
-  mov rax, QWORD PTR [rbp-32]
-  push rax
-  mov rax, QWORD PTR [rbp-24]
-  push rax
-  pop rbx
-  pop rax
-  mov rdi, rax
-  mov rsi, rbx
-  call cmp_less
-  cmp rax, 0
-  je if1
-if0:
-  mov rax, QWORD PTR [rbp-24]
-  push rax
-  mov rax, QWORD PTR [rbp-32]
-  pop rbx
-  push rax
-  mov rax, rbx
-  pop rbx
+  sub rsp, 32
+  mov QWORD PTR [rbp-8], rbx
+  mov QWORD PTR [rbp-16], r12
+  mov QWORD PTR [rbp-24], r13
+  call scan_int
+  mov rbx, rax
+  mov r12, 2
+  xor r13d, r13d
+  test rbx, rbx
+  jle .Lmain_2
+.Lmain_1:
+  xor esi, esi
+  mov rdi, 2
+  xor r8d, r8d
+  cmp r12, 2
+  jle .Lmain_4
+.Lmain_3:
+  mov rax, r12
   cqo
-  xor rdx, rdx
-  idiv rbx
-  mov rax, rdx
-  push rax
-  mov rax, 0
-  push rax
-  pop rbx
-  pop rax
-  mov rdi, rax
-  mov rsi, rbx
-  call cmp_eq
-  cmp rax, 1
-  je cond0
-  jmp main2
-cond0:
-  mov rax, QWORD PTR [rbp-40]
-  push rax
-  mov rax, 1
-  pop rbx
-  add rax, rbx
-  mov QWORD PTR [rbp-40], rax
-  jmp main2
-main2:
-  mov rax, QWORD PTR [rbp-32]
-  push rax
-  mov rax, 1
-  pop rbx
-  add rax, rbx
-  mov QWORD PTR [rbp-32], rax
-  jmp loop1
-if1:
-  mov rax, QWORD PTR [rbp-40]
-  push rax
-  mov rax, 0
-  push rax
-  pop rbx
-  pop rax
-  mov rdi, rax
-  mov rsi, rbx
-  call cmp_eq
-  cmp rax, 1
-  je cond1
-  jmp main3
-cond1:
-  mov rax, QWORD PTR [rbp-24]
-  lea rdi, print_format
-  mov rsi, rax
-  xor rax, rax
-  call printf
-  mov rax, QWORD PTR [rbp-16]
-  push rax
-  mov rax, 1
-  pop rbx
-  add rax, rbx
-  mov QWORD PTR [rbp-16], rax
-  jmp main3
-main3:
-  mov rax, QWORD PTR [rbp-24]
-  push rax
-  mov rax, 1
-  pop rbx
-  add rax, rbx
-  mov QWORD PTR [rbp-24], rax
-  jmp loop0
-main0:
+  idiv rdi
+  mov r9, rdx
+  mov r8, rsi
+  test r9, r9
+  jne .Lmain_5
+.Lmain_6:
+  mov r8, rsi
+  add r8, 1
+.Lmain_5:
+  add rdi, 1
+  mov rsi, r8
+  cmp rdi, r12
+  jl .Lmain_3
+.Lmain_4:
+  mov rsi, r13
+  test r8, r8
+  jne .Lmain_7
+.Lmain_8:
+  mov rdi, r12
+  call print_int
+  mov rsi, r13
+  add rsi, 1
+.Lmain_7:
+  add r12, 1
+  mov r13, rsi
+  cmp r13, rbx
+  jl .Lmain_1
+.Lmain_2:
+  xor eax, eax
+  mov rbx, QWORD PTR [rbp-8]
+  mov r12, QWORD PTR [rbp-16]
+  mov r13, QWORD PTR [rbp-24]
   leave
   ret
 
@@ -1,8 +1,6 @@
 .intel_syntax noprefix
 
 .data
-  print_format: .asciz "%ld\n"
-  scan_format: .asciz "%ld"
 
 .text
 
@@ -10,63 +8,37 @@
 main:
   push rbp
   mov rbp, rsp
-  sub rsp, 32
-  mov rax, 0
-  mov QWORD PTR [rbp-8], rax
-  lea rdi, scan_format
-  lea rsi, [rbp-8]
-  xor rax, rax
-  call scanf
-  mov rax, 0
-  mov QWORD PTR [rbp-16], rax
-loop0:
-  mov rax, QWORD PTR [rbp-8]
-  push rax
-  mov rax, 0
-  push rax
-  pop rbx
-  pop rax
-  mov rdi, rax
-  mov rsi, rbx
-  call cmp_neq
-  cmp rax, 0
-  je main0
-  mov rax, QWORD PTR [rbp-8]
-  push rax
-  mov rax, 10
-  pop rbx
-  push rax
-  mov rax, rbx
-  pop rbx
-  cqo
-  xor rdx, rdx
-  idiv rbx
-  mov rax, rdx
-  mov QWORD PTR [rbp-24], rax
-  mov rax, QWORD PTR [rbp-16]
-  push rax
-  mov rax, QWORD PTR [rbp-24]
-  pop rbx
-  add rax, rbx
-  mov QWORD PTR [rbp-16], rax
-  mov rax, QWORD PTR [rbp-8]
-  push rax
-  mov rax, 10
-  pop rbx
-  push rax
-  mov rax, rbx
-  pop rbx
-  cqo
-  xor rdx, rdx
-  idiv rbx
-  mov QWORD PTR [rbp-8], rax
-  jmp loop0
-main0:
-  mov rax, QWORD PTR [rbp-16]
-  lea rdi, print_format
+  call scan_int
   mov rsi, rax
-  xor rax, rax
-  call printf
+  xor edi, edi
+  xor r8d, r8d
+  test rsi, rsi
+  je .Lmain_2
+.Lmain_1:
+  mov rax, 7378697629483820647
+  imul rsi
+  sar rdx, 2
+  mov rax, rdx
+  shr rax, 63
+  add rdx, rax
+  imul rdx, rdx, 10
+  mov r8, rsi
+  sub r8, rdx
+  add r8, rdi
+  mov rax, 7378697629483820647
+  imul rsi
+  sar rdx, 2
+  mov rax, rdx
+  shr rax, 63
+  add rdx, rax
+  mov rsi, rdx
+  mov rdi, r8
+  test rsi, rsi
+  jne .Lmain_1
+.Lmain_2:
+  mov rdi, r8
+  call print_int
+  xor eax, eax
   leave
   ret
 
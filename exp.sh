@@ -1,6 +1,7 @@
 exp_run () {
     if [[ "$1" == *.exp ]]; then
-        /bin/exp $1 > "${2}.s"
+        rm -f "${2}.s"
+        /bin/exp $1 -o "${2}.s"
         if [[ $? == 0 ]]; then
             echo "[INFO] AST tree successfully created"
         else 
@@ -13,7 +14,7 @@ exp_run () {
     if [[ -s "${2}.s" ]];
     then 
         ASM_OPS=$(find /home -type f -name asm_ops.c)
-        gcc $ASM_OPS -m64 -fno-pie -no-pie "${2}.s" -g -o $2 2>/dev/null
+        gcc $ASM_OPS -O2 -m64 -fno-pie -no-pie "${2}.s" -g -o $2 2>/dev/null
         if [[ $? != 0 ]]; then
             echo "[ERROR] Compilation error"
         else 
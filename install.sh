@@ -13,7 +13,7 @@ fi
 lex frontend/lexer.l
 echo "[INFO] Lexer successfully built"
 bison -d frontend/parser.ypp 2>/dev/null
-g++ -Wall -Wextra ast/ast.cpp lex.yy.c parser.tab.cpp -g -o exp
+g++ -Wall -Wextra ast/ast.cpp ast/arena.cpp ast/symtab.cpp ast/emitter.cpp ir/ir.cpp ir/lower.cpp ir/ssa.cpp opt/opt.cpp opt/tailcall.cpp opt/inline.cpp opt/constfold.cpp opt/dce.cpp opt/escape.cpp opt/bounds.cpp opt/licm.cpp opt/vectorize.cpp backend/x86.cpp backend/peephole.cpp lex.yy.c parser.tab.cpp -g -o exp
 echo "[INFO] Parser successfully built"
 
 sudo cp exp /bin
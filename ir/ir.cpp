@@ -0,0 +1,280 @@
+#include "ir.hpp"
+#include "../ast/emitter.hpp"
+#include <algorithm>
+
+IRInst::IRInst(IROp _op, int _dst, std::vector<Operand> _args) {
+    op = _op;
+    dst = _dst;
+    args = _args;
+};
+
+bool IRInst::is_call() const {
+    switch (op) {
+        case _IR_CALL_ :
+        case _IR_PRINT_ :
+        case _IR_SCAN_ :
+        case _IR_PRINT_ARR_ :
+        case _IR_SCAN_ARR_ :
+        case _IR_ALLOC_ :
+        case _IR_FREE_ : return true;
+        default : return false;
+    }
+};
+
+bool IRInst::has_side_effect() const {
+    switch (op) {
+        case _IR_STORE_ :
+        case _IR_FILL_ :
+        case _IR_CHECK_ :
+        case _IR_FREE_ :
+        case _IR_VLOOP_ :
+        case _IR_CALL_ :
+        case _IR_PRINT_ :
+        case _IR_SCAN_ :
+        case _IR_PRINT_ARR_ :
+        case _IR_SCAN_ARR_ :
+        case _IR_JMP_ :
+        case _IR_BR_ :
+        case _IR_RET_ : return true;
+        default : return false;
+    }
+};
+
+BasicBlock::BasicBlock(int _id, int _loop_depth) {
+    id = _id;
+    loop_depth = _loop_depth;
+};
+
+IRFunction::IRFunction(std::string _name) {
+    name = _name;
+};
+
+BasicBlock* IRFunction::new_block(int loop_depth, bool place) {
+    BasicBlock* bb = ast_arena.make<BasicBlock>(num_blocks++, loop_depth);
+    if (place) { blocks.push_back(bb); }
+    return bb;
+};
+
+void IRFunction::rebuild_cfg() {
+    std::vector<char> reached(blocks.size(), 0);
+    std::vector<int> index_of;
+    for (int i = 0; i < (int)blocks.size(); ++i) {
+        if ((int)index_of.size() <= blocks[i]->id) { index_of.resize(blocks[i]->id + 1, -1); }
+        index_of[blocks[i]->id] = i;
+    }
+
+    std::vector<BasicBlock*> stack = {blocks[0]};
+    reached[0] = 1;
+    while (!stack.empty()) {
+        BasicBlock* bb = stack.back();
+        stack.pop_back();
+        for (auto* succ : bb->succs) {
+            int i = index_of[succ->id];
+            if (!reached[i]) {
+                reached[i] = 1;
+                stack.push_back(succ);
+            }
+        }
+    }
+
+    std::vector<BasicBlock*> live;
+    for (int i = 0; i < (int)blocks.size(); ++i) {
+        if (reached[i]) { live.push_back(blocks[i]); }
+    }
+    blocks = live;
+    for (int i = 0; i < (int)blocks.size(); ++i) { blocks[i]->index = i; }
+
+    std::vector<std::vector<BasicBlock*>> old_preds;
+    for (auto* bb : blocks) {
+        old_preds.push_back(bb->preds);
+        bb->preds.clear();
+    }
+    for (auto* bb : blocks) {
+        for (auto* succ : bb->succs) { succ->preds.push_back(bb); }
+    }
+
+    // phi arguments follow their predecessor into the new order
+    for (int i = 0; i < (int)blocks.size(); ++i) {
+        BasicBlock* bb = blocks[i];
+        for (auto& inst : bb->insts) {
+            if (inst.op != _IR_PHI_) { break; }
+            std::vector<Operand> args;
+            for (auto* pred : bb->preds) {
+                auto it = std::find(old_preds[i].begin(), old_preds[i].end(), pred);
+                args.push_back(inst.args[it - old_preds[i].begin()]);
+            }
+            inst.args = args;
+        }
+    }
+};
+
+VRegSet::VRegSet(int num_vregs) {
+    words.assign((num_vregs + 63) / 64, 0);
+};
+
+bool VRegSet::merge(const VRegSet& other) {
+    bool changed = false;
+    for (int i = 0; i < (int)words.size(); ++i) {
+        uint64_t merged = words[i] | other.words[i];
+        changed |= merged != words[i];
+        words[i] = merged;
+    }
+    return changed;
+};
+
+Liveness::Liveness(IRFunction* func) {
+    int n = func->blocks.size();
+    bit.assign(func->num_vregs, -1);
+
+    std::vector<int> defined_in(func->num_vregs, -1);
+    auto upward = [&](int vreg) {
+        if (bit[vreg] < 0) {
+            bit[vreg] = vregs.size();
+            vregs.push_back(vreg);
+        }
+    };
+    for (int i = 0; i < n; ++i) {
+        for (auto& inst : func->blocks[i]->insts) {
+            for (auto& arg : inst.args) {
+                if (arg.is_vreg() && (inst.op == _IR_PHI_ || defined_in[arg.val] != i)) { upward(arg.val); }
+            }
+            if (inst.dst >= 0) { defined_in[inst.dst] = i; }
+        }
+    }
+
+    int num_bits = vregs.size();
+    std::vector<VRegSet> gen(n, VRegSet(num_bits));
+    std::vector<VRegSet> kill(n, VRegSet(num_bits));
+    // phi arguments, charged to the end of the predecessor they come from
+    std::vector<VRegSet> phi_uses(n, VRegSet(num_bits));
+
+    for (int i = 0; i < n; ++i) {
+        BasicBlock* bb = func->blocks[i];
+        for (auto& inst : bb->insts) {
+            if (inst.op == _IR_PHI_) {
+                for (int j = 0; j < (int)inst.args.size(); ++j) {
+                    if (inst.args[j].is_vreg()) { phi_uses[bb->preds[j]->index].add(bit[inst.args[j].val]); }
+                }
+            }
+            else {
+                for (auto& arg : inst.args) {
+                    if (arg.is_vreg() && bit[arg.val] >= 0 && !kill[i].has(bit[arg.val])) { gen[i].add(bit[arg.val]); }
+                }
+            }
+            if (inst.dst >= 0 && bit[inst.dst] >= 0) { kill[i].add(bit[inst.dst]); }
+        }
+    }
+
+    live_in.assign(n, VRegSet(num_bits));
+    live_out = phi_uses;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = n - 1; i >= 0; --i) {
+            for (auto* succ : func->blocks[i]->succs) { live_out[i].merge(live_in[succ->index]); }
+
+            VRegSet in = gen[i];
+            for (int w = 0; w < (int)in.words.size(); ++w) {
+                in.words[w] |= live_out[i].words[w] & ~kill[i].words[w];
+            }
+            changed |= live_in[i].merge(in);
+        }
+    }
+};
+
+static const char* op_name(IROp op) {
+    switch (op) {
+        case _IR_CONST_ : return "const";
+        case _IR_COPY_ : return "copy";
+        case _IR_ADD_ : return "add";
+        case _IR_SUB_ : return "sub";
+        case _IR_MUL_ : return "mul";
+        case _IR_DIV_ : return "div";
+        case _IR_MOD_ : return "mod";
+        case _IR_SHL_ : return "shl";
+        case _IR_SHR_ : return "shr";
+        case _IR_AND_ : return "and";
+        case _IR_OR_ : return "or";
+        case _IR_NOT_ : return "not";
+        case _IR_NEG_ : return "neg";
+        case _IR_CMP_ : return "cmp";
+        case _IR_LOAD_ : return "load";
+        case _IR_STORE_ : return "store";
+        case _IR_ALLOC_ : return "alloc";
+        case _IR_FREE_ : return "free";
+        case _IR_FILL_ : return "fill";
+        case _IR_CHECK_ : return "check";
+        case _IR_CALL_ : return "call";
+        case _IR_PRINT_ : return "print";
+        case _IR_SCAN_ : return "scan";
+        case _IR_PRINT_ARR_ : return "print_arr";
+        case _IR_SCAN_ARR_ : return "scan_arr";
+        case _IR_PARAM_ : return "param";
+        case _IR_PHI_ : return "phi";
+        case _IR_SIMD_ : return "simd";
+        case _IR_VLOOP_ : return "vloop";
+        case _IR_JMP_ : return "jmp";
+        case _IR_BR_ : return "br";
+        case _IR_RET_ : return "ret";
+    }
+    return "?";
+};
+
+static const char* cc_name(Tag cc) {
+    switch (cc) {
+        case _LESS_ : return "lt";
+        case _GREAT_ : return "gt";
+        case _EQ_ : return "eq";
+        case _NEQ_ : return "ne";
+        case _LEQ_ : return "le";
+        case _GEQ_ : return "ge";
+        default : return "?";
+    }
+};
+
+static void dump_operand(IRFunction* func, const Operand& opnd) {
+    switch (opnd.kind) {
+        case _OPND_VREG_ : asm_out << "v" << opnd.val; break;
+        case _OPND_IMM_ : asm_out << opnd.val; break;
+        case _OPND_ARR_ : asm_out << "@" << func->arrays[opnd.val].name; break;
+        default : asm_out << "_"; break;
+    }
+};
+
+void dump_ir(IRModule* mod) {
+    for (auto* func : mod->funcs) {
+        asm_out << "func " << func->name << "(" << func->num_params << ")" << (func->ssa ? " ssa" : "") << ":" << '\n';
+        for (auto& arr : func->arrays) {
+            asm_out << "  array @" << arr.name << "[" << arr.size << "]" << '\n';
+        }
+        for (auto* bb : func->blocks) {
+            asm_out << "  bb" << bb->id << ":";
+            if (!bb->preds.empty()) {
+                asm_out << "  ; preds";
+                for (auto* pred : bb->preds) { asm_out << " bb" << pred->id; }
+            }
+            if (bb->loop_depth) { asm_out << "  ; depth " << bb->loop_depth; }
+            asm_out << '\n';
+
+            for (auto& inst : bb->insts) {
+                asm_out << "    ";
+                if (inst.dst >= 0) { asm_out << "v" << inst.dst << " = "; }
+                asm_out << op_name(inst.op);
+                if (inst.op == _IR_CMP_ || inst.op == _IR_BR_ || inst.op == _IR_CHECK_) { asm_out << " " << cc_name(inst.cc); }
+                if (inst.op == _IR_CALL_) { asm_out << " " << inst.func; }
+                if (inst.op == _IR_VLOOP_) { asm_out << (inst.vec->isa == _SIMD_AVX2_ ? " avx2" : " sse4.2"); }
+                for (int i = 0; i < (int)inst.args.size(); ++i) {
+                    asm_out << (i ? ", " : " ");
+                    dump_operand(func, inst.args[i]);
+                    if (inst.op == _IR_PHI_) { asm_out << " [bb" << bb->preds[i]->id << "]"; }
+                }
+                if (!bb->succs.empty() && inst.is_terminator()) {
+                    asm_out << " ->";
+                    for (auto* succ : bb->succs) { asm_out << " bb" << succ->id; }
+                }
+                asm_out << '\n';
+            }
+        }
+        asm_out << '\n';
+    }
+};
@@ -0,0 +1,208 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "../ast/ast.hpp"
+
+#ifndef IR_HPP
+#define IR_HPP
+
+// Three-address IR. Every function is a list of basic blocks over an
+// unbounded set of virtual registers (vregs) holding 64-bit integers; the
+// last instruction of a block is its terminator and the CFG edges are kept
+// in succs/preds.
+enum IROp {
+    _IR_CONST_,   // dst = a                       (a is an immediate)
+    _IR_COPY_,    // dst = a
+    _IR_ADD_,     // dst = a + b
+    _IR_SUB_,
+    _IR_MUL_,
+    _IR_DIV_,
+    _IR_MOD_,
+    _IR_SHL_,
+    _IR_SHR_,
+    _IR_AND_,
+    _IR_OR_,
+    _IR_NOT_,     // dst = ~a
+    _IR_NEG_,     // dst = -a
+    _IR_CMP_,     // dst = a cc b ? 1 : 0
+    _IR_LOAD_,    // dst = a[b]                    (a is an array base)
+    _IR_STORE_,   // a[b] = c
+    _IR_ALLOC_,   // dst = new array of a elements set to b
+    _IR_FREE_,    // release array a, a no-op when a is 0
+    _IR_FILL_,    // a[0] to a[b-1] = c            (a is a stack array, b an immediate)
+    _IR_CHECK_,   // stop at source line c unless b cc length of array a (cc is lt or le)
+    _IR_CALL_,    // dst = func(args...)
+    _IR_PRINT_,   // print a
+    _IR_SCAN_,    // dst = next input number
+    _IR_PRINT_ARR_, // print a[0] to a[b-1]
+    _IR_SCAN_ARR_,  // a[0] to a[b-1] = next b input numbers
+    _IR_PARAM_,   // dst = incoming argument number a
+    _IR_PHI_,     // dst = args[i] when coming from preds[i]
+    _IR_SIMD_,    // dst = SimdISA the running cpu supports best, NONE to AVX2
+    _IR_VLOOP_,   // vector loop described by vec, dst = its reduction
+    _IR_JMP_,     // goto succs[0]
+    _IR_BR_,      // if (a cc b) goto succs[0] else goto succs[1]
+    _IR_RET_      // return a
+};
+
+enum OperandKind { _OPND_NONE_, _OPND_VREG_, _OPND_IMM_, _OPND_ARR_ };
+
+// A vreg, an immediate, or a stack array of the function (arrays[id]).
+struct Operand {
+    OperandKind kind = _OPND_NONE_;
+    int64_t val = 0;
+
+    static Operand vreg(int id) { return {_OPND_VREG_, id}; }
+    static Operand imm(int64_t num) { return {_OPND_IMM_, num}; }
+    static Operand arr(int id) { return {_OPND_ARR_, id}; }
+    bool is_vreg() const { return kind == _OPND_VREG_; }
+    bool is_imm() const { return kind == _OPND_IMM_; }
+    bool is_arr() const { return kind == _OPND_ARR_; }
+    bool operator==(const Operand& other) const { return kind == other.kind && val == other.val; }
+    bool operator!=(const Operand& other) const { return !(*this == other); }
+};
+
+// How array accesses are guarded: not at all, each one by a check, or by
+// the checks range analysis cannot prove to always pass
+enum BoundsMode { _BOUNDS_UNCHECKED_, _BOUNDS_CHECKED_, _BOUNDS_ELIDED_ };
+
+// Instruction sets vector code can be built for. DISPATCH builds it for
+// both and picks one at run time.
+enum SimdISA { _SIMD_NONE_, _SIMD_SSE42_, _SIMD_AVX2_, _SIMD_DISPATCH_ };
+
+// Lane-wise step of a vectorized loop body. Registers are numbered from 0
+// and stand for xmm or ymm registers; LOAD and STORE address args[a] of
+// the loop at the current index, STORE writes register b, and SHL shifts
+// by the constant b.
+struct VecOp {
+    IROp op;
+    int dst = -1;
+    int a = -1;
+    int b = -1;
+    Tag cc = _EQ_;
+};
+
+// Loop from args[0] to args[1], which is past args[0] and a whole number
+// of vectors away from it, running body over one vector of lanes at a time.
+// A reduction accumulates lane-wise in acc and is folded into args[2] with
+// reduce at the end.
+struct VecLoop {
+    SimdISA isa;
+    // (register, argument) pairs broadcast to all lanes before the loop
+    std::vector<std::pair<int, int>> splats;
+    // register holding the index of every lane, -1 when unused
+    int index = -1;
+    int acc = -1;
+    IROp reduce = _IR_ADD_;
+    std::vector<VecOp> body;
+};
+
+class IRInst {
+public:
+    IROp op;
+    int dst = -1;
+    std::vector<Operand> args;
+    Tag cc = _EQ_;
+    std::string func;
+    VecLoop* vec = nullptr;
+
+    IRInst(IROp _op, int _dst, std::vector<Operand> _args);
+    bool is_terminator() const { return op == _IR_JMP_ || op == _IR_BR_ || op == _IR_RET_; }
+    // Calls out of the function, clobbering the caller-saved registers
+    bool is_call() const;
+    // Has an effect besides writing dst
+    bool has_side_effect() const;
+};
+
+class BasicBlock {
+public:
+    int id;
+    // position in IRFunction::blocks, kept up to date by rebuild_cfg()
+    int index = 0;
+    int loop_depth = 0;
+    std::vector<IRInst> insts;
+    std::vector<BasicBlock*> succs;
+    std::vector<BasicBlock*> preds;
+
+    BasicBlock(int _id, int _loop_depth);
+    IRInst& terminator() { return insts.back(); }
+};
+
+// Fixed-size array living in the function's stack frame
+struct StackArray {
+    std::string name;
+    int size;
+};
+
+class IRFunction {
+public:
+    std::string name;
+    int num_params = 0;
+    int num_vregs = 0;
+    int num_blocks = 0;
+    bool ssa = false;
+    // blocks[0] is the entry; the order is also the emission layout
+    std::vector<BasicBlock*> blocks;
+    std::vector<StackArray> arrays;
+
+    IRFunction(std::string _name);
+    int new_vreg() { return num_vregs++; }
+    // Unplaced blocks are left out of the layout until pushed onto blocks
+    BasicBlock* new_block(int loop_depth, bool place = true);
+    // Recomputes preds from the successor lists and drops blocks that
+    // cannot be reached from the entry
+    void rebuild_cfg();
+};
+
+class IRModule {
+public:
+    std::vector<IRFunction*> funcs;
+    IRFunction* main_func = nullptr;
+};
+
+// Set of vregs, one bit each
+class VRegSet {
+public:
+    std::vector<uint64_t> words;
+
+    VRegSet(int num_vregs = 0);
+    bool has(int vreg) const { return words[vreg >> 6] >> (vreg & 63) & 1; }
+    void add(int vreg) { words[vreg >> 6] |= 1ULL << (vreg & 63); }
+    void remove(int vreg) { words[vreg >> 6] &= ~(1ULL << (vreg & 63)); }
+    // Adds every member of other, returns whether anything was new
+    bool merge(const VRegSet& other);
+};
+
+// Vregs live on entry to and exit from every block, indexed like
+// IRFunction::blocks. A phi reads its arguments at the end of the matching
+// predecessor and defines its result at the top of its own block. Only
+// vregs read in some block before being written there can be live across
+// a block boundary, so the sets are kept over those alone.
+class Liveness {
+public:
+    // vreg -> bit in the sets, -1 for vregs local to a block
+    std::vector<int> bit;
+    // bit -> vreg
+    std::vector<int> vregs;
+    std::vector<VRegSet> live_in;
+    std::vector<VRegSet> live_out;
+
+    Liveness(IRFunction* func);
+    bool is_live_in(int block, int vreg) const { return bit[vreg] >= 0 && live_in[block].has(bit[vreg]); }
+    bool is_live_out(int block, int vreg) const { return bit[vreg] >= 0 && live_out[block].has(bit[vreg]); }
+};
+
+// Immediate dominator of every block as an index into IRFunction::blocks,
+// the entry being its own
+std::vector<int> compute_idoms(IRFunction* func);
+
+IRModule* lower_program(ASTNode* prog, ProgState* state, BoundsMode bounds);
+
+// Rewrites func into SSA form with pruned phis, and back into plain
+// three-address code with copies
+void build_ssa(IRFunction* func);
+void leave_ssa(IRFunction* func);
+
+void dump_ir(IRModule* mod);
+
+#endif
@@ -0,0 +1,482 @@
+#include "ir.hpp"
+#include <unordered_map>
+#include <algorithm>
+
+// Lowers one frame (main or a function body) to IR. Every scalar variable
+// and every dynamic array base gets one vreg for its whole lifetime, static
+// arrays become slots in IRFunction::arrays.
+class Lowering {
+public:
+    Lowering(IRFunction* _func, bool _is_main, bool _checked);
+    void lower_params(const std::vector<ASTNode*>& params);
+    void memoize(int table, const std::vector<ASTNode*>& params);
+    void lower_body(ASTNode* stmts);
+
+private:
+    IRFunction* func;
+    bool is_main;
+    // whether array accesses get bounds checks
+    bool checked;
+    BasicBlock* cur;
+    int loop_depth = 0;
+    std::unordered_map<Symbol*, int> vars;
+    std::unordered_map<Symbol*, int> arrays;
+    // vregs of the dynamic arrays, in declaration order
+    std::vector<int> dyn_arrays;
+    // memo table of a function marked @memo (-1 otherwise), and the frame
+    // array holding its arguments as the key
+    int memo_table = -1;
+    Operand memo_key;
+    int memo_args = 0;
+
+    int var_vreg(Symbol* sym);
+    Operand arr_base(Symbol* sym);
+    void emit(IROp op, int dst, std::vector<Operand> args);
+    void check(Operand base, Operand idx, Tag cc, int line);
+    void jump(BasicBlock* target);
+    void ret(Operand val);
+    void branch(Tag cc, Operand a, Operand b, BasicBlock* taken, BasicBlock* other);
+    void place(BasicBlock* bb);
+    void open_block();
+    Operand lower_expr(ASTNode* ptr, int dst = -1);
+    void lower_cond(ASTNode* cond, BasicBlock* taken, BasicBlock* other, bool test_one);
+    void lower_stmts(ASTNode* ptr);
+    void free_arrays();
+};
+
+static bool is_cmp(Tag tag) {
+    return tag >= _LESS_ && tag <= _GEQ_;
+};
+
+static IROp bin_op(Tag tag) {
+    switch (tag) {
+        case _ADD_ : return _IR_ADD_;
+        case _SUB_ : return _IR_SUB_;
+        case _MUL_ : return _IR_MUL_;
+        case _DIV_ : return _IR_DIV_;
+        case _MOD_ : return _IR_MOD_;
+        case _SHL_ : return _IR_SHL_;
+        case _SHR_ : return _IR_SHR_;
+        case _AND_ : return _IR_AND_;
+        case _OR_ : return _IR_OR_;
+        default : return _IR_CMP_;
+    }
+};
+
+// Comparisons and &&/|| over them only ever produce 0 or 1
+static bool is_bool(ASTNode* ptr) {
+    auto* bin_op_node = node_cast<BinaryNode>(ptr);
+    if (!bin_op_node) { return false; }
+    if (is_cmp(bin_op_node->tag)) { return true; }
+    if (bin_op_node->tag == _AND_ || bin_op_node->tag == _OR_) {
+        return is_bool(bin_op_node->left) && is_bool(bin_op_node->right);
+    }
+    return false;
+};
+
+static bool has_call(ASTNode* ptr) {
+    if (!ptr) { return false; }
+
+    switch (ptr->kind) {
+        case _FUNC_CALL_NODE_ : return true;
+        case _ARR_ELEM_NODE_ : return has_call(static_cast<ArrayElemNode*>(ptr)->elem_index);
+        case _BIN_OP_NODE_ : {
+            auto* bin_op_node = static_cast<BinaryNode*>(ptr);
+            return has_call(bin_op_node->left) || has_call(bin_op_node->right);
+        }
+        default : return false;
+    }
+};
+
+Lowering::Lowering(IRFunction* _func, bool _is_main, bool _checked) {
+    func = _func;
+    is_main = _is_main;
+    checked = _checked;
+    cur = func->new_block(0);
+};
+
+int Lowering::var_vreg(Symbol* sym) {
+    auto it = vars.find(sym);
+    if (it != vars.end()) { return it->second; }
+    int id = func->new_vreg();
+    vars[sym] = id;
+    return id;
+};
+
+Operand Lowering::arr_base(Symbol* sym) {
+    if (sym->arr_ty == ArrayType::_DYN_) { return Operand::vreg(var_vreg(sym)); }
+
+    auto it = arrays.find(sym);
+    if (it == arrays.end()) {
+        arrays[sym] = func->arrays.size();
+        func->arrays.push_back({sym->name.substr(1, sym->name.size() - 2), 0});
+        it = arrays.find(sym);
+    }
+    StackArray& arr = func->arrays[it->second];
+    arr.size = std::max(arr.size, sym->arr_size);
+    return Operand::arr(it->second);
+};
+
+void Lowering::emit(IROp op, int dst, std::vector<Operand> args) {
+    cur->insts.emplace_back(op, dst, args);
+};
+
+void Lowering::check(Operand base, Operand idx, Tag cc, int line) {
+    if (!checked) { return; }
+    emit(_IR_CHECK_, -1, {base, idx, Operand::imm(line)});
+    cur->insts.back().cc = cc;
+};
+
+void Lowering::jump(BasicBlock* target) {
+    emit(_IR_JMP_, -1, {});
+    cur->succs = {target};
+};
+
+void Lowering::ret(Operand val) {
+    if (memo_table >= 0) {
+        emit(_IR_CALL_, -1, {Operand::imm(memo_table), memo_key, Operand::imm(memo_args), val});
+        cur->insts.back().func = "memo_store";
+    }
+    emit(_IR_RET_, -1, {val});
+};
+
+void Lowering::branch(Tag cc, Operand a, Operand b, BasicBlock* taken, BasicBlock* other) {
+    emit(_IR_BR_, -1, {a, b});
+    cur->insts.back().cc = cc;
+    cur->succs = {taken, other};
+};
+
+// Blocks are created unplaced and enter the layout when code starts
+// going into them, so the layout follows the source.
+void Lowering::place(BasicBlock* bb) {
+    if (cur->insts.empty() || !cur->insts.back().is_terminator()) { jump(bb); }
+    func->blocks.push_back(bb);
+    cur = bb;
+};
+
+// Code after a ret goes into a fresh block nothing jumps to
+void Lowering::open_block() {
+    if (!cur->insts.empty() && cur->insts.back().is_terminator()) {
+        cur = func->new_block(loop_depth);
+    }
+};
+
+// Evaluates ptr left to right; the result lands in dst when one is given
+Operand Lowering::lower_expr(ASTNode* ptr, int dst) {
+    Operand res;
+    if (!ptr) {
+        res = Operand::imm(0);
+    }
+    else {
+        switch (ptr->kind) {
+            case _NUM_NODE_ : {
+                res = Operand::imm(static_cast<NumNode*>(ptr)->num);
+                break;
+            }
+            case _VAR_NODE_ : {
+                res = Operand::vreg(var_vreg(static_cast<VarNode*>(ptr)->sym));
+                break;
+            }
+            case _ARR_ELEM_NODE_ : {
+                auto* arrElem_node = static_cast<ArrayElemNode*>(ptr);
+                Operand idx = lower_expr(arrElem_node->elem_index);
+                Operand base = arr_base(arrElem_node->sym);
+                check(base, idx, _LESS_, arrElem_node->line_index);
+                if (dst < 0) { dst = func->new_vreg(); }
+                emit(_IR_LOAD_, dst, {base, idx});
+                return Operand::vreg(dst);
+            }
+            case _FUNC_CALL_NODE_ : {
+                auto* funcCall_node = static_cast<FuncCall*>(ptr);
+                // the parser keeps the arguments last to first
+                std::vector<Operand> args;
+                for (int i = funcCall_node->func_args.size() - 1; i >= 0; --i) {
+                    args.push_back(lower_expr(funcCall_node->func_args[i]));
+                }
+                if (dst < 0) { dst = func->new_vreg(); }
+                emit(_IR_CALL_, dst, args);
+                cur->insts.back().func = funcCall_node->func_name;
+                return Operand::vreg(dst);
+            }
+            case _BIN_OP_NODE_ : {
+                auto* bin_op_node = static_cast<BinaryNode*>(ptr);
+                if (bin_op_node->tag == _NOT_ || bin_op_node->tag == _NEG_) {
+                    Operand val = lower_expr(bin_op_node->right);
+                    if (dst < 0) { dst = func->new_vreg(); }
+                    emit(bin_op_node->tag == _NOT_ ? _IR_NOT_ : _IR_NEG_, dst, {val});
+                    return Operand::vreg(dst);
+                }
+
+                Operand left = lower_expr(bin_op_node->left);
+                Operand right = lower_expr(bin_op_node->right);
+                if (dst < 0) { dst = func->new_vreg(); }
+                emit(bin_op(bin_op_node->tag), dst, {left, right});
+                if (is_cmp(bin_op_node->tag)) { cur->insts.back().cc = bin_op_node->tag; }
+                return Operand::vreg(dst);
+            }
+            default : {
+                res = Operand::imm(0);
+                break;
+            }
+        }
+    }
+
+    if (dst >= 0 && res != Operand::vreg(dst)) {
+        emit(res.is_imm() ? _IR_CONST_ : _IR_COPY_, dst, {res});
+        return Operand::vreg(dst);
+    }
+    return res;
+};
+
+// Branches to taken when cond holds: equal to 1 for if-statements, non-zero
+// for while-loops. Comparisons fuse into the branch, &&/|| of comparisons
+// short-circuit unless skipping the right side would skip a call.
+void Lowering::lower_cond(ASTNode* cond, BasicBlock* taken, BasicBlock* other, bool test_one) {
+    auto* bin_op_node = node_cast<BinaryNode>(cond);
+    if (bin_op_node && is_cmp(bin_op_node->tag)) {
+        Operand left = lower_expr(bin_op_node->left);
+        Operand right = lower_expr(bin_op_node->right);
+        branch(bin_op_node->tag, left, right, taken, other);
+        return;
+    }
+
+    if (bin_op_node && is_bool(cond) && !has_call(bin_op_node->right)) {
+        BasicBlock* rest = func->new_block(loop_depth, false);
+        if (bin_op_node->tag == _AND_) { lower_cond(bin_op_node->left, rest, other, test_one); }
+        else { lower_cond(bin_op_node->left, taken, rest, test_one); }
+        func->blocks.push_back(rest);
+        cur = rest;
+        lower_cond(bin_op_node->right, taken, other, test_one);
+        return;
+    }
+
+    Operand val = lower_expr(cond);
+    branch(test_one ? _EQ_ : _NEQ_, val, Operand::imm(test_one ? 1 : 0), taken, other);
+};
+
+void Lowering::lower_stmts(ASTNode* ptr) {
+    while (ptr) {
+        open_block();
+        ASTNode* next = nullptr;
+
+        switch (ptr->kind) {
+            case _MAIN_NODE_ : {
+                next = static_cast<MainNode*>(ptr)->next;
+                break;
+            }
+            case _ASSIGN_NODE_ : {
+                auto* assign_node = static_cast<AssignNode*>(ptr);
+                lower_expr(assign_node->assign_val, var_vreg(assign_node->sym));
+                next = assign_node->next;
+                break;
+            }
+            case _ARR_ELEM_ASSIGN_NODE_ : {
+                auto* arrElemAssign_node = static_cast<ArrayElemAssignNode*>(ptr);
+                if (arrElemAssign_node->sym) {
+                    Operand idx = lower_expr(arrElemAssign_node->elem_index);
+                    Operand val = lower_expr(arrElemAssign_node->assign_val);
+                    Operand base = arr_base(arrElemAssign_node->sym);
+                    check(base, idx, _LESS_, arrElemAssign_node->line_index);
+                    emit(_IR_STORE_, -1, {base, idx, val});
+                }
+                next = arrElemAssign_node->next;
+                break;
+            }
+            case _PRINT_NODE_ : {
+                auto* print_node = static_cast<PrintNode*>(ptr);
+                emit(_IR_PRINT_, -1, {lower_expr(print_node->print_val)});
+                next = print_node->next;
+                break;
+            }
+            case _SCAN_NODE_ : {
+                auto* scan_node = static_cast<ScanNode*>(ptr);
+                emit(_IR_SCAN_, var_vreg(scan_node->sym), {});
+                next = scan_node->next;
+                break;
+            }
+            case _ARR_PRINT_NODE_ : {
+                auto* arrPrint_node = static_cast<ArrayPrintNode*>(ptr);
+                Operand count = lower_expr(arrPrint_node->count);
+                Operand base = arr_base(arrPrint_node->sym);
+                check(base, count, _LEQ_, arrPrint_node->line_index);
+                emit(_IR_PRINT_ARR_, -1, {base, count});
+                next = arrPrint_node->next;
+                break;
+            }
+            case _ARR_SCAN_NODE_ : {
+                auto* arrScan_node = static_cast<ArrayScanNode*>(ptr);
+                Operand count = lower_expr(arrScan_node->count);
+                Operand base = arr_base(arrScan_node->sym);
+                check(base, count, _LEQ_, arrScan_node->line_index);
+                emit(_IR_SCAN_ARR_, -1, {base, count});
+                next = arrScan_node->next;
+                break;
+            }
+            case _STAT_ARR_DECL_NODE_ : {
+                auto* statArrDecl_node = static_cast<StatArrayDeclNode*>(ptr);
+                Operand base = arr_base(statArrDecl_node->sym);
+                for (int i = 0; i < (int)statArrDecl_node->arr_vals.size(); ++i) {
+                    Operand val = lower_expr(statArrDecl_node->arr_vals[i]);
+                    emit(_IR_STORE_, -1, {base, Operand::imm(i), val});
+                }
+                next = statArrDecl_node->next;
+                break;
+            }
+            case _DYN_ARR_DECL_NODE_ : {
+                auto* dynArrDecl_node = static_cast<DynArrayDeclNode*>(ptr);
+                Operand size = lower_expr(dynArrDecl_node->arr_size);
+                Operand val = lower_expr(dynArrDecl_node->arr_val);
+                int base = var_vreg(dynArrDecl_node->sym);
+                if (std::find(dyn_arrays.begin(), dyn_arrays.end(), base) == dyn_arrays.end()) { dyn_arrays.push_back(base); }
+                // the array this declaration replaces
+                emit(_IR_FREE_, -1, {Operand::vreg(base)});
+                emit(_IR_ALLOC_, base, {size, val});
+                next = dynArrDecl_node->next;
+                break;
+            }
+            case _IF_ELSE_NODE_ : {
+                auto* if_else_node = static_cast<IfElseNode*>(ptr);
+                BasicBlock* join = func->new_block(loop_depth, false);
+
+                // conds runs from the last arm back to the if
+                for (int i = if_else_node->conds.size() - 1; i >= 0; --i) {
+                    auto& arm = if_else_node->conds[i];
+                    if (arm.first) {
+                        BasicBlock* body = func->new_block(loop_depth, false);
+                        BasicBlock* rest = i > 0 ? func->new_block(loop_depth, false) : join;
+                        lower_cond(arm.first, body, rest, true);
+                        place(body);
+                        lower_stmts(arm.second);
+                        if (cur->insts.empty() || !cur->insts.back().is_terminator()) { jump(join); }
+                        if (rest != join) {
+                            func->blocks.push_back(rest);
+                            cur = rest;
+                        }
+                    }
+                    else {
+                        lower_stmts(arm.second);
+                        if (cur->insts.empty() || !cur->insts.back().is_terminator()) { jump(join); }
+                    }
+                }
+                func->blocks.push_back(join);
+                cur = join;
+                next = if_else_node->next;
+                break;
+            }
+            case _WHILE_NODE_ : {
+                auto* while_node = static_cast<WhileNode*>(ptr);
+                // test once on entry, then at the bottom so each iteration
+                // costs a single conditional branch
+                BasicBlock* body = func->new_block(loop_depth + 1, false);
+                BasicBlock* exit = func->new_block(loop_depth, false);
+                lower_cond(while_node->cond, body, exit, false);
+
+                loop_depth += 1;
+                place(body);
+                lower_stmts(while_node->stmts);
+                open_block();
+                lower_cond(while_node->cond, body, exit, false);
+                loop_depth -= 1;
+
+                func->blocks.push_back(exit);
+                cur = exit;
+                next = while_node->next;
+                break;
+            }
+            case _RETURN_NODE_ : {
+                auto* return_node = static_cast<ReturnNode*>(ptr);
+                Operand val = lower_expr(return_node->return_val);
+                // the program's exit status stays 0
+                ret(is_main ? Operand::imm(0) : val);
+                next = return_node->next;
+                break;
+            }
+            case _FUNC_DEF_NODE_ : {
+                next = static_cast<FuncDef*>(ptr)->next;
+                break;
+            }
+            default : break;
+        }
+
+        ptr = next;
+    }
+};
+
+void Lowering::lower_params(const std::vector<ASTNode*>& params) {
+    for (int i = 0; i < (int)params.size(); ++i) {
+        auto* var_node = node_cast<VarNode>(params[i]);
+        if (var_node) { emit(_IR_PARAM_, var_vreg(var_node->sym), {Operand::imm(i)}); }
+    }
+    func->num_params = params.size();
+};
+
+// A function marked @memo first looks its arguments up in its table and
+// returns what it finds there; every return stores the value under them
+void Lowering::memoize(int table, const std::vector<ASTNode*>& params) {
+    memo_table = table;
+    memo_args = params.size();
+    memo_key = Operand::arr(func->arrays.size());
+    func->arrays.push_back({"memo_key", std::max(1, memo_args)});
+    for (int i = 0; i < memo_args; ++i) {
+        auto* var_node = node_cast<VarNode>(params[i]);
+        if (var_node) { emit(_IR_STORE_, -1, {memo_key, Operand::imm(i), Operand::vreg(var_vreg(var_node->sym))}); }
+    }
+
+    int found = func->new_vreg();
+    emit(_IR_CALL_, found, {Operand::imm(table), memo_key, Operand::imm(memo_args)});
+    cur->insts.back().func = "memo_lookup";
+    BasicBlock* hit = func->new_block(0, false);
+    BasicBlock* body = func->new_block(0, false);
+    branch(_NEQ_, Operand::vreg(found), Operand::imm(INT64_MIN), hit, body);
+    place(hit);
+    emit(_IR_RET_, -1, {Operand::vreg(found)});
+    place(body);
+};
+
+void Lowering::lower_body(ASTNode* stmts) {
+    lower_stmts(stmts);
+    if (cur->insts.empty() || !cur->insts.back().is_terminator()) { ret(Operand::imm(0)); }
+    free_arrays();
+    func->rebuild_cfg();
+};
+
+// Dynamic arrays start out as 0 so a declaration can always free the one
+// it replaces, and every return of a function frees those still held
+// (main leaves them to the exit).
+void Lowering::free_arrays() {
+    if (dyn_arrays.empty()) { return; }
+
+    auto& entry = func->blocks[0]->insts;
+    auto at = entry.begin();
+    while (at != entry.end() && at->op == _IR_PARAM_) { ++at; }
+    for (int base : dyn_arrays) { at = entry.insert(at, IRInst(_IR_CONST_, base, {Operand::imm(0)})) + 1; }
+    if (is_main) { return; }
+
+    for (auto* bb : func->blocks) {
+        if (bb->insts.empty() || bb->insts.back().op != _IR_RET_) { continue; }
+        for (int base : dyn_arrays) { bb->insts.insert(bb->insts.end() - 1, IRInst(_IR_FREE_, -1, {Operand::vreg(base)})); }
+    }
+};
+
+IRModule* lower_program(ASTNode* prog, ProgState* state, BoundsMode bounds) {
+    IRModule* mod = ast_arena.make<IRModule>();
+
+    int memo_tables = 0;
+    for (auto* it : state->symtab.global.funcs) {
+        auto* funcDef_node = node_cast<FuncDef>(it->func_node);
+        if (!funcDef_node) { continue; }
+
+        IRFunction* func = ast_arena.make<IRFunction>(funcDef_node->func_name);
+        Lowering lowering(func, false, bounds != _BOUNDS_UNCHECKED_);
+        lowering.lower_params(funcDef_node->func_args);
+        if (funcDef_node->memo) { lowering.memoize(memo_tables++, funcDef_node->func_args); }
+        lowering.lower_body(funcDef_node->func_stmts);
+        mod->funcs.push_back(func);
+    }
+
+    mod->main_func = ast_arena.make<IRFunction>("main");
+    Lowering lowering(mod->main_func, true, bounds != _BOUNDS_UNCHECKED_);
+    lowering.lower_body(prog);
+    mod->funcs.push_back(mod->main_func);
+    return mod;
+};
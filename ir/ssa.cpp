@@ -0,0 +1,232 @@
+#include "ir.hpp"
+#include <algorithm>
+
+static std::vector<int> reverse_postorder(IRFunction* func) {
+    std::vector<int> order;
+    std::vector<char> seen(func->blocks.size(), 0);
+    // (block, next successor to visit)
+    std::vector<std::pair<int, int>> stack = {{0, 0}};
+    seen[0] = 1;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        BasicBlock* bb = func->blocks[top.first];
+        if (top.second < (int)bb->succs.size()) {
+            int succ = bb->succs[top.second++]->index;
+            if (!seen[succ]) {
+                seen[succ] = 1;
+                stack.push_back({succ, 0});
+            }
+            continue;
+        }
+        order.push_back(top.first);
+        stack.pop_back();
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+};
+
+// Cooper, Harvey and Kennedy's iterative algorithm over reverse postorder
+std::vector<int> compute_idoms(IRFunction* func) {
+    int n = func->blocks.size();
+    std::vector<int> rpo = reverse_postorder(func);
+    std::vector<int> rpo_num(n, 0);
+    for (int i = 0; i < (int)rpo.size(); ++i) { rpo_num[rpo[i]] = i; }
+
+    std::vector<int> idom(n, -1);
+    idom[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b : rpo) {
+            if (b == 0) { continue; }
+            int new_idom = -1;
+            for (auto* pred : func->blocks[b]->preds) {
+                int p = pred->index;
+                if (idom[p] < 0) { continue; }
+                if (new_idom < 0) {
+                    new_idom = p;
+                    continue;
+                }
+                int x = p, y = new_idom;
+                while (x != y) {
+                    while (rpo_num[x] > rpo_num[y]) { x = idom[x]; }
+                    while (rpo_num[y] > rpo_num[x]) { y = idom[y]; }
+                }
+                new_idom = x;
+            }
+            if (idom[b] != new_idom) {
+                idom[b] = new_idom;
+                changed = true;
+            }
+        }
+    }
+    return idom;
+};
+
+class SSABuilder {
+public:
+    SSABuilder(IRFunction* _func);
+    void run();
+
+private:
+    IRFunction* func;
+    int num_vars;
+    int undef = -1;
+    std::vector<int> idom;
+    std::vector<std::vector<int>> dom_children;
+    std::vector<std::vector<int>> stacks;
+
+    void insert_phis();
+    int current(int var);
+    void rename(int b);
+};
+
+SSABuilder::SSABuilder(IRFunction* _func) {
+    func = _func;
+    num_vars = func->num_vregs;
+};
+
+// Phis go into the iterated dominance frontier of every definition, but
+// only where the variable is live on entry
+void SSABuilder::insert_phis() {
+    int n = func->blocks.size();
+    Liveness live(func);
+
+    std::vector<std::vector<int>> frontier(n);
+    for (int b = 0; b < n; ++b) {
+        BasicBlock* bb = func->blocks[b];
+        if (bb->preds.size() < 2) { continue; }
+        for (auto* pred : bb->preds) {
+            int runner = pred->index;
+            while (runner != idom[b]) {
+                auto& df = frontier[runner];
+                if (std::find(df.begin(), df.end(), b) == df.end()) { df.push_back(b); }
+                runner = idom[runner];
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> def_blocks(num_vars);
+    for (int b = 0; b < n; ++b) {
+        for (auto& inst : func->blocks[b]->insts) {
+            if (inst.dst < 0) { continue; }
+            auto& defs = def_blocks[inst.dst];
+            if (defs.empty() || defs.back() != b) { defs.push_back(b); }
+        }
+    }
+
+    std::vector<int> has_phi(n, -1);
+    std::vector<int> queued(n, -1);
+    for (int var = 0; var < num_vars; ++var) {
+        std::vector<int> work = def_blocks[var];
+        for (int b : work) { queued[b] = var; }
+        while (!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            for (int y : frontier[b]) {
+                if (has_phi[y] == var || !live.is_live_in(y, var)) { continue; }
+                has_phi[y] = var;
+
+                BasicBlock* bb = func->blocks[y];
+                std::vector<Operand> args(bb->preds.size(), Operand::vreg(var));
+                bb->insts.insert(bb->insts.begin(), IRInst(_IR_PHI_, var, args));
+                if (queued[y] != var) {
+                    queued[y] = var;
+                    work.push_back(y);
+                }
+            }
+        }
+    }
+};
+
+// Reads of a variable no definition reaches see 0
+int SSABuilder::current(int var) {
+    if (!stacks[var].empty()) { return stacks[var].back(); }
+    if (undef < 0) { undef = func->new_vreg(); }
+    return undef;
+};
+
+void SSABuilder::rename(int b) {
+    BasicBlock* bb = func->blocks[b];
+    std::vector<int> pushed;
+
+    for (auto& inst : bb->insts) {
+        if (inst.op != _IR_PHI_) {
+            for (auto& arg : inst.args) {
+                if (arg.is_vreg()) { arg.val = current(arg.val); }
+            }
+        }
+        if (inst.dst >= 0) {
+            int var = inst.dst;
+            inst.dst = func->new_vreg();
+            stacks[var].push_back(inst.dst);
+            pushed.push_back(var);
+        }
+    }
+
+    for (auto* succ : bb->succs) {
+        for (int j = 0; j < (int)succ->preds.size(); ++j) {
+            if (succ->preds[j] != bb) { continue; }
+            for (auto& inst : succ->insts) {
+                if (inst.op != _IR_PHI_) { break; }
+                Operand& arg = inst.args[j];
+                if (arg.is_vreg() && arg.val < num_vars) { arg.val = current(arg.val); }
+            }
+        }
+    }
+
+    for (int child : dom_children[b]) { rename(child); }
+    for (int var : pushed) { stacks[var].pop_back(); }
+};
+
+void SSABuilder::run() {
+    func->rebuild_cfg();
+    idom = compute_idoms(func);
+    dom_children.assign(func->blocks.size(), {});
+    for (int b = 1; b < (int)func->blocks.size(); ++b) { dom_children[idom[b]].push_back(b); }
+
+    insert_phis();
+    stacks.assign(num_vars, {});
+    rename(0);
+
+    if (undef >= 0) {
+        auto& insts = func->blocks[0]->insts;
+        auto it = insts.begin();
+        while (it != insts.end() && it->op == _IR_PARAM_) { ++it; }
+        insts.insert(it, IRInst(_IR_CONST_, undef, {Operand::imm(0)}));
+    }
+    func->ssa = true;
+};
+
+void build_ssa(IRFunction* func) {
+    if (func->ssa) { return; }
+    SSABuilder(func).run();
+};
+
+// Every phi gets a fresh temporary written at the end of each predecessor
+// and copied into the phi's result at the top of the block. The temporaries
+// are private to their phi, so the copies never clobber each other and no
+// edge has to be split.
+void leave_ssa(IRFunction* func) {
+    if (!func->ssa) { return; }
+
+    for (auto* bb : func->blocks) {
+        // a loop block is its own predecessor, so index rather than iterate
+        for (int i = 0; i < (int)bb->insts.size() && bb->insts[i].op == _IR_PHI_; ++i) {
+            std::vector<Operand> args = bb->insts[i].args;
+            int tmp = func->new_vreg();
+            for (int j = 0; j < (int)bb->preds.size(); ++j) {
+                auto& pred_insts = bb->preds[j]->insts;
+                pred_insts.insert(pred_insts.end() - 1, IRInst(args[j].is_imm() ? _IR_CONST_ : _IR_COPY_, tmp, {args[j]}));
+                // the branch reads the copy so the value can die there and
+                // share the temporary's register
+                for (auto& arg : pred_insts.back().args) {
+                    if (args[j].is_vreg() && arg == args[j]) { arg = Operand::vreg(tmp); }
+                }
+            }
+            bb->insts[i].op = _IR_COPY_;
+            bb->insts[i].args = {Operand::vreg(tmp)};
+        }
+    }
+    func->ssa = false;
+};
@@ -0,0 +1,237 @@
+#include "opt.hpp"
+#include <algorithm>
+#include <climits>
+
+// Smallest value of a vreg when nothing better is known
+const int64_t UNKNOWN = INT64_MIN;
+
+static bool dominates(const std::vector<int>& idom, int a, int b) {
+    while (b != a && b != 0) { b = idom[b]; }
+    return b == a;
+};
+
+static Tag negate(Tag cc) {
+    switch (cc) {
+        case _LESS_ : return _GEQ_;
+        case _GREAT_ : return _LEQ_;
+        case _LEQ_ : return _GREAT_;
+        case _GEQ_ : return _LESS_;
+        case _EQ_ : return _NEQ_;
+        case _NEQ_ : return _EQ_;
+        default : return cc;
+    }
+};
+
+// x < y when strict, x <= y otherwise
+struct Bound {
+    Operand x;
+    Operand y;
+    bool strict;
+};
+
+// Proves bounds checks redundant with what the branches leading to them
+// establish. Values are in SSA form and each is defined once, so a
+// relation between two values that held when control passed a branch
+// still holds further down as long as neither was defined anew, which
+// dominance guarantees for everything checked here.
+class BoundsElider {
+public:
+    BoundsElider(IRFunction* _func);
+    void run();
+
+private:
+    IRFunction* func;
+    std::vector<int> idom;
+    // block and instruction defining every vreg
+    std::vector<int> def_block;
+    std::vector<const IRInst*> def;
+
+    Operand resolve(Operand opnd);
+    bool edge_bound(BasicBlock* from, BasicBlock* to, Bound& bound);
+    Operand length(const Operand& base);
+    bool nonnegative(const Operand& len);
+    bool below(const Operand& limit, bool strict, const Operand& len);
+    bool phi_below(const IRInst& phi, int block, const Operand& len);
+    int64_t least(const Operand& opnd, const Operand& len, int depth);
+    bool upper(const Operand& opnd, const Operand& len, const std::vector<Bound>& facts, int depth);
+    bool passes(const IRInst& check, int block);
+};
+
+BoundsElider::BoundsElider(IRFunction* _func) {
+    func = _func;
+    idom = compute_idoms(func);
+    def_block.assign(func->num_vregs, -1);
+    def.assign(func->num_vregs, nullptr);
+    for (auto* bb : func->blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst.dst < 0) { continue; }
+            def_block[inst.dst] = bb->index;
+            def[inst.dst] = &inst;
+        }
+    }
+};
+
+Operand BoundsElider::resolve(Operand opnd) {
+    while (opnd.is_vreg() && def[opnd.val] && def[opnd.val]->op == _IR_COPY_) { opnd = def[opnd.val]->args[0]; }
+    return opnd;
+};
+
+// The relation the branch ending from guarantees on its edge to to
+bool BoundsElider::edge_bound(BasicBlock* from, BasicBlock* to, Bound& bound) {
+    IRInst& term = from->terminator();
+    if (term.op != _IR_BR_ || from->succs[0] == from->succs[1]) { return false; }
+    Tag cc = from->succs[0] == to ? term.cc : negate(term.cc);
+    Operand x = resolve(term.args[0]);
+    Operand y = resolve(term.args[1]);
+    switch (cc) {
+        case _LESS_ : bound = {x, y, true}; return true;
+        case _GREAT_ : bound = {y, x, true}; return true;
+        case _LEQ_ : bound = {x, y, false}; return true;
+        case _GEQ_ : bound = {y, x, false}; return true;
+        default : return false;
+    }
+};
+
+// What the length of base was allocated from, none when unknown
+Operand BoundsElider::length(const Operand& base) {
+    if (base.is_arr()) { return Operand::imm(func->arrays[base.val].size); }
+    Operand at = resolve(base);
+    if (!at.is_vreg() || !def[at.val] || def[at.val]->op != _IR_ALLOC_) { return Operand(); }
+    Operand len = resolve(def[at.val]->args[0]);
+    if (len.is_imm() && len.val < 0) { return Operand::imm(0); }
+    return len;
+};
+
+// A negative length allocates nothing, so only a non-negative one is
+// what the array really holds
+bool BoundsElider::nonnegative(const Operand& len) {
+    return len.is_imm() ? len.val >= 0 : least(len, len, 4) >= 0;
+};
+
+// Whether being below limit (or at most limit) keeps a value below len
+bool BoundsElider::below(const Operand& limit, bool strict, const Operand& len) {
+    if (limit.is_imm() && len.is_imm()) { return strict ? limit.val <= len.val : limit.val < len.val; }
+    if (strict && limit == len) { return true; }
+    // len - c, which wraps around for a negative len
+    if (!limit.is_vreg() || !def[limit.val] || def[limit.val]->op != _IR_SUB_) { return false; }
+    const IRInst& sub = *def[limit.val];
+    if (resolve(sub.args[0]) != len || !sub.args[1].is_imm() || sub.args[1].val < (strict ? 0 : 1)) { return false; }
+    return nonnegative(len);
+};
+
+// A loop counter stays below len when every way into its phi does
+bool BoundsElider::phi_below(const IRInst& phi, int block, const Operand& len) {
+    if (len.is_vreg() && (def_block[len.val] < 0 || def_block[len.val] == block || !dominates(idom, def_block[len.val], block))) { return false; }
+    BasicBlock* bb = func->blocks[block];
+    for (int j = 0; j < (int)phi.args.size(); ++j) {
+        Operand in = resolve(phi.args[j]);
+        if (in == Operand::vreg(phi.dst)) { continue; }
+        if (in.is_imm() && len.is_imm() && in.val < len.val) { continue; }
+        Bound bound;
+        if (!edge_bound(bb->preds[j], bb, bound) || bound.x != in || !below(bound.y, bound.strict, len)) { return false; }
+    }
+    return true;
+};
+
+// Steps of at most this much can neither wrap a value around nor carry it
+// past an array length unnoticed
+const int64_t MAX_STEP = 1 << 16;
+
+static bool small(const Operand& opnd) {
+    return opnd.is_imm() && opnd.val >= -MAX_STEP && opnd.val <= MAX_STEP;
+};
+
+// A loop counter that only ever grows by small steps starts out at its
+// smallest. Without a bound keeping it below len it could wrap around.
+int64_t BoundsElider::least(const Operand& opnd, const Operand& len, int depth) {
+    Operand at = resolve(opnd);
+    if (at.is_imm()) { return at.val; }
+    if (!at.is_vreg() || !def[at.val] || depth == 0) { return UNKNOWN; }
+    const IRInst& inst = *def[at.val];
+    switch (inst.op) {
+        case _IR_CONST_ : return inst.args[0].val;
+        case _IR_CMP_ : return 0;
+        case _IR_AND_ : return std::max(least(inst.args[0], len, depth - 1), least(inst.args[1], len, depth - 1)) >= 0 ? 0 : UNKNOWN;
+        case _IR_SUB_ : {
+            int64_t from = least(inst.args[0], len, depth - 1);
+            return small(inst.args[1]) && inst.args[1].val >= 0 && from > UNKNOWN + MAX_STEP ? from - inst.args[1].val : UNKNOWN;
+        }
+        case _IR_PHI_ : {
+            int64_t low = INT64_MAX;
+            for (auto& arg : inst.args) {
+                Operand in = resolve(arg);
+                if (in == at) { continue; }
+                const IRInst* step = in.is_vreg() ? def[in.val] : nullptr;
+                if (step && step->op == _IR_ADD_ && resolve(step->args[0]) == at && small(step->args[1]) && step->args[1].val >= 0) {
+                    if (!phi_below(inst, def_block[at.val], len)) { return UNKNOWN; }
+                    continue;
+                }
+                low = std::min(low, least(in, len, depth - 1));
+            }
+            return low;
+        }
+        default : return UNKNOWN;
+    }
+};
+
+// Whether opnd stays below len, given the relations facts the branches on
+// the way in guarantee. Subtracting cannot take it past len, and the
+// check for the lower bound rules out wrapping around.
+bool BoundsElider::upper(const Operand& opnd, const Operand& len, const std::vector<Bound>& facts, int depth) {
+    Operand at = resolve(opnd);
+    if (at.is_imm() && len.is_imm()) { return at.val < len.val; }
+    for (auto& fact : facts) {
+        if (fact.x == at && below(fact.y, fact.strict, len)) { return true; }
+    }
+    if (!at.is_vreg() || !def[at.val] || depth == 0) { return false; }
+    const IRInst& inst = *def[at.val];
+    if (inst.op == _IR_PHI_) { return phi_below(inst, def_block[at.val], len); }
+    return inst.op == _IR_SUB_ && small(inst.args[1]) && inst.args[1].val >= 0 && upper(inst.args[0], len, facts, depth - 1);
+};
+
+bool BoundsElider::passes(const IRInst& check, int block) {
+    Operand len = length(check.args[0]);
+    Operand idx = resolve(check.args[1]);
+    if (len.kind == _OPND_NONE_) { return false; }
+    if (check.cc == _LEQ_) { return (idx == len && nonnegative(len)) || (idx.is_imm() && len.is_imm() && idx.val >= 0 && idx.val <= len.val); }
+
+    std::vector<Bound> facts;
+    bool lower = least(idx, len, 4) >= 0;
+    for (int c = block; c != 0; c = idom[c]) {
+        BasicBlock* bb = func->blocks[c];
+        Bound bound;
+        if (bb->preds.size() != 1 || !edge_bound(bb->preds[0], bb, bound)) { continue; }
+        facts.push_back(bound);
+        if (bound.y == idx && bound.x.is_imm() && bound.x.val >= (bound.strict ? -1 : 0)) { lower = true; }
+    }
+    return lower && upper(idx, len, facts, 4);
+};
+
+void BoundsElider::run() {
+    // decide on every check first, def points into the blocks
+    std::vector<std::vector<char>> redundant;
+    for (auto* bb : func->blocks) {
+        redundant.emplace_back(bb->insts.size(), 0);
+        for (int i = 0; i < (int)bb->insts.size(); ++i) {
+            if (bb->insts[i].op == _IR_CHECK_) { redundant.back()[i] = passes(bb->insts[i], bb->index); }
+        }
+    }
+    for (int b = 0; b < (int)func->blocks.size(); ++b) {
+        BasicBlock* bb = func->blocks[b];
+        std::vector<IRInst> kept;
+        for (int i = 0; i < (int)bb->insts.size(); ++i) {
+            if (!redundant[b][i]) { kept.push_back(bb->insts[i]); }
+        }
+        bb->insts = kept;
+    }
+};
+
+void elide_bounds_checks(IRModule* mod) {
+    for (auto* func : mod->funcs) {
+        bool any = false;
+        for (auto* bb : func->blocks) {
+            for (auto& inst : bb->insts) { any |= inst.op == _IR_CHECK_; }
+        }
+        if (any) { BoundsElider(func).run(); }
+    }
+};
@@ -0,0 +1,325 @@
+#include "opt.hpp"
+#include <unordered_map>
+#include <climits>
+
+// Lattice of a vreg: no executable definition seen yet, one constant, or
+// more than one value
+enum ConstState { _CV_UNKNOWN_, _CV_CONST_, _CV_VARYING_ };
+
+struct ConstVal {
+    ConstState state = _CV_UNKNOWN_;
+    int64_t val = 0;
+
+    static ConstVal known(int64_t num) { return {_CV_CONST_, num}; }
+    static ConstVal varying() { return {_CV_VARYING_, 0}; }
+    bool is_const() const { return state == _CV_CONST_; }
+    bool operator==(const ConstVal& other) const { return state == other.state && val == other.val; }
+    bool operator!=(const ConstVal& other) const { return !(*this == other); }
+};
+
+static ConstVal meet(ConstVal a, ConstVal b) {
+    if (a.state == _CV_UNKNOWN_) { return b; }
+    if (b.state == _CV_UNKNOWN_) { return a; }
+    if (a.is_const() && b.is_const() && a.val == b.val) { return a; }
+    return ConstVal::varying();
+};
+
+static bool cmp_holds(Tag cc, int64_t a, int64_t b) {
+    switch (cc) {
+        case _LESS_ : return a < b;
+        case _GREAT_ : return a > b;
+        case _EQ_ : return a == b;
+        case _NEQ_ : return a != b;
+        case _LEQ_ : return a <= b;
+        case _GEQ_ : return a >= b;
+        default : return false;
+    }
+};
+
+// Arithmetic wraps like the machine does; divisions that would trap are
+// left for run time
+static bool fold(const IRInst& inst, int64_t a, int64_t b, int64_t& res) {
+    uint64_t ua = a, ub = b;
+    switch (inst.op) {
+        case _IR_ADD_ : res = ua + ub; return true;
+        case _IR_SUB_ : res = ua - ub; return true;
+        case _IR_MUL_ : res = ua * ub; return true;
+        case _IR_DIV_ :
+        case _IR_MOD_ : {
+            if (b == 0 || (a == INT64_MIN && b == -1)) { return false; }
+            res = inst.op == _IR_DIV_ ? a / b : a % b;
+            return true;
+        }
+        case _IR_SHL_ : res = ua << (b & 63); return true;
+        case _IR_SHR_ : res = a >> (b & 63); return true;
+        case _IR_AND_ : res = a & b; return true;
+        case _IR_OR_ : res = a | b; return true;
+        case _IR_NOT_ : res = ~a; return true;
+        case _IR_NEG_ : res = 0 - ua; return true;
+        case _IR_CMP_ : res = cmp_holds(inst.cc, a, b); return true;
+        default : return false;
+    }
+};
+
+// What the rest of the program knows about a function: the value of each
+// parameter on entry and of its result
+struct FuncFacts {
+    std::vector<ConstVal> params;
+    ConstVal ret = ConstVal::varying();
+};
+
+typedef std::unordered_map<std::string, FuncFacts> ModuleFacts;
+
+// Wegman and Zadeck's algorithm: values start unknown and blocks
+// unreachable, and both only move down as definitions and CFG edges are
+// found executable.
+class ConstFolder {
+public:
+    // meet of the values returned on executable paths
+    ConstVal ret;
+    // calls in executable blocks
+    std::vector<IRInst*> calls;
+
+    ConstFolder(IRFunction* _func, const ModuleFacts* _facts);
+    void analyze();
+    void rewrite();
+    ConstVal value(const Operand& opnd);
+
+private:
+    IRFunction* func;
+    const ModuleFacts* facts;
+    std::vector<ConstVal> vals;
+    std::vector<char> block_exec;
+    // per block, per successor
+    std::vector<std::vector<char>> edge_exec;
+    // vreg -> (block, instruction) reading it
+    std::vector<std::vector<std::pair<int, int>>> uses;
+    std::vector<int> ssa_work;
+
+    ConstVal eval(const IRInst& inst);
+    void mark_edge(int b, int k);
+    void visit(int b, int i);
+};
+
+ConstFolder::ConstFolder(IRFunction* _func, const ModuleFacts* _facts) {
+    func = _func;
+    facts = _facts;
+};
+
+ConstVal ConstFolder::value(const Operand& opnd) {
+    if (opnd.is_imm()) { return ConstVal::known(opnd.val); }
+    if (opnd.is_vreg()) { return vals[opnd.val]; }
+    return ConstVal::varying();
+};
+
+ConstVal ConstFolder::eval(const IRInst& inst) {
+    switch (inst.op) {
+        case _IR_CONST_ :
+        case _IR_COPY_ : return value(inst.args[0]);
+        case _IR_PARAM_ : {
+            auto it = facts->find(func->name);
+            if (it == facts->end() || inst.args[0].val >= (int64_t)it->second.params.size()) { return ConstVal::varying(); }
+            return it->second.params[inst.args[0].val];
+        }
+        case _IR_CALL_ : {
+            auto it = facts->find(inst.func);
+            return it == facts->end() ? ConstVal::varying() : it->second.ret;
+        }
+        case _IR_LOAD_ :
+        case _IR_ALLOC_ :
+        case _IR_SCAN_ :
+        case _IR_SIMD_ :
+        case _IR_VLOOP_ : return ConstVal::varying();
+        default : break;
+    }
+
+    ConstVal a = value(inst.args[0]);
+    ConstVal b = inst.args.size() > 1 ? value(inst.args[1]) : ConstVal::known(0);
+    if (a.state == _CV_VARYING_ || b.state == _CV_VARYING_) { return ConstVal::varying(); }
+    if (a.state == _CV_UNKNOWN_ || b.state == _CV_UNKNOWN_) { return ConstVal(); }
+
+    int64_t res;
+    if (!fold(inst, a.val, b.val, res)) { return ConstVal::varying(); }
+    return ConstVal::known(res);
+};
+
+void ConstFolder::mark_edge(int b, int k) {
+    if (edge_exec[b][k]) { return; }
+    edge_exec[b][k] = 1;
+
+    BasicBlock* succ = func->blocks[b]->succs[k];
+    int s = succ->index;
+    if (!block_exec[s]) {
+        block_exec[s] = 1;
+        for (int i = 0; i < (int)succ->insts.size(); ++i) { visit(s, i); }
+        return;
+    }
+    // a new way in can only change the phis
+    for (int i = 0; i < (int)succ->insts.size() && succ->insts[i].op == _IR_PHI_; ++i) { visit(s, i); }
+};
+
+void ConstFolder::visit(int b, int i) {
+    BasicBlock* bb = func->blocks[b];
+    IRInst& inst = bb->insts[i];
+
+    switch (inst.op) {
+        case _IR_JMP_ : {
+            mark_edge(b, 0);
+            return;
+        }
+        case _IR_BR_ : {
+            ConstVal x = value(inst.args[0]);
+            ConstVal y = value(inst.args[1]);
+            if (x.is_const() && y.is_const()) {
+                mark_edge(b, cmp_holds(inst.cc, x.val, y.val) ? 0 : 1);
+            }
+            else if (x.state == _CV_VARYING_ || y.state == _CV_VARYING_) {
+                mark_edge(b, 0);
+                mark_edge(b, 1);
+            }
+            return;
+        }
+        case _IR_RET_ : {
+            ret = meet(ret, value(inst.args[0]));
+            return;
+        }
+        default : break;
+    }
+    if (inst.dst < 0) { return; }
+
+    ConstVal res;
+    if (inst.op == _IR_PHI_) {
+        for (int j = 0; j < (int)inst.args.size(); ++j) {
+            BasicBlock* pred = bb->preds[j];
+            for (int k = 0; k < (int)pred->succs.size(); ++k) {
+                if (pred->succs[k] == bb && edge_exec[pred->index][k]) { res = meet(res, value(inst.args[j])); }
+            }
+        }
+    }
+    else {
+        res = eval(inst);
+    }
+
+    res = meet(res, vals[inst.dst]);
+    if (res != vals[inst.dst]) {
+        vals[inst.dst] = res;
+        ssa_work.push_back(inst.dst);
+    }
+};
+
+void ConstFolder::analyze() {
+    int n = func->blocks.size();
+    vals.assign(func->num_vregs, ConstVal());
+    block_exec.assign(n, 0);
+    edge_exec.assign(n, {});
+    uses.assign(func->num_vregs, {});
+    for (int b = 0; b < n; ++b) {
+        BasicBlock* bb = func->blocks[b];
+        edge_exec[b].assign(bb->succs.size(), 0);
+        for (int i = 0; i < (int)bb->insts.size(); ++i) {
+            for (auto& arg : bb->insts[i].args) {
+                if (arg.is_vreg()) { uses[arg.val].push_back({b, i}); }
+            }
+        }
+    }
+
+    block_exec[0] = 1;
+    for (int i = 0; i < (int)func->blocks[0]->insts.size(); ++i) { visit(0, i); }
+    while (!ssa_work.empty()) {
+        int v = ssa_work.back();
+        ssa_work.pop_back();
+        for (auto& use : uses[v]) {
+            if (block_exec[use.first]) { visit(use.first, use.second); }
+        }
+    }
+
+    for (int b = 0; b < n; ++b) {
+        if (!block_exec[b]) { continue; }
+        for (auto& inst : func->blocks[b]->insts) {
+            if (inst.op == _IR_CALL_) { calls.push_back(&inst); }
+        }
+    }
+};
+
+// Constant vregs become immediates and their definitions go unless they
+// have another effect; blocks no executable edge reaches drop out with
+// the cfg rebuild.
+void ConstFolder::rewrite() {
+    for (int b = 0; b < (int)func->blocks.size(); ++b) {
+        if (!block_exec[b]) { continue; }
+        BasicBlock* bb = func->blocks[b];
+
+        std::vector<IRInst> kept;
+        for (auto& inst : bb->insts) {
+            if (inst.dst >= 0 && vals[inst.dst].is_const() && !inst.has_side_effect()) { continue; }
+            for (auto& arg : inst.args) {
+                if (arg.is_vreg() && vals[arg.val].is_const()) { arg = Operand::imm(vals[arg.val].val); }
+            }
+            // an array that is still 0 was never allocated
+            if (inst.op == _IR_FREE_ && inst.args[0].is_imm()) { continue; }
+            kept.push_back(inst);
+        }
+        bb->insts = kept;
+
+        IRInst& term = bb->terminator();
+        if (term.op == _IR_BR_ && term.args[0].is_imm() && term.args[1].is_imm()) {
+            BasicBlock* target = bb->succs[cmp_holds(term.cc, term.args[0].val, term.args[1].val) ? 0 : 1];
+            term = IRInst(_IR_JMP_, -1, {});
+            bb->succs = {target};
+        }
+    }
+    func->rebuild_cfg();
+};
+
+const int MAX_ROUNDS = 8;
+
+// Starts from knowing nothing about parameters and results and reruns the
+// analysis while call sites still teach something new. Every round only
+// builds on facts already proven, so stopping at any point is sound.
+void fold_constants(IRModule* mod) {
+    ModuleFacts facts;
+    for (auto* func : mod->funcs) {
+        facts[func->name].params.assign(func->num_params, ConstVal::varying());
+    }
+
+    bool changed = true;
+    for (int round = 0; changed && round < MAX_ROUNDS; ++round) {
+        ModuleFacts found;
+        for (auto* func : mod->funcs) {
+            found[func->name].params.assign(func->num_params, ConstVal());
+        }
+
+        for (auto* func : mod->funcs) {
+            ConstFolder folder(func, &facts);
+            folder.analyze();
+            if (folder.ret.is_const()) { found[func->name].ret = folder.ret; }
+
+            for (auto* call : folder.calls) {
+                auto it = found.find(call->func);
+                if (it == found.end()) { continue; }
+                auto& params = it->second.params;
+                for (int i = 0; i < (int)params.size(); ++i) {
+                    params[i] = meet(params[i], i < (int)call->args.size() ? folder.value(call->args[i]) : ConstVal::varying());
+                }
+            }
+        }
+
+        changed = false;
+        for (auto* func : mod->funcs) {
+            FuncFacts& now = found[func->name];
+            // functions nothing calls keep their parameters unknown to us
+            for (auto& param : now.params) {
+                if (!param.is_const()) { param = ConstVal::varying(); }
+            }
+            FuncFacts& before = facts[func->name];
+            changed |= now.params != before.params || now.ret != before.ret;
+        }
+        facts = found;
+    }
+
+    for (auto* func : mod->funcs) {
+        ConstFolder folder(func, &facts);
+        folder.analyze();
+        folder.rewrite();
+    }
+};
@@ -0,0 +1,178 @@
+#include "opt.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+static int find(std::vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+};
+
+// Arrays never leave the function that makes them and their bases only
+// move through copies and phis, so vregs joined by those form one group
+// per array (stack arrays come after the vregs). A group is read when a
+// load goes through it or one of its vregs is used any other way than as
+// the base of a store, fill or free.
+static std::vector<char> read_arrays(IRFunction* func, std::vector<int>& group) {
+    int n = func->num_vregs + func->arrays.size();
+    group.resize(n);
+    for (int x = 0; x < n; ++x) { group[x] = x; }
+    for (auto* bb : func->blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst.op != _IR_COPY_ && inst.op != _IR_PHI_) { continue; }
+            for (auto& arg : inst.args) {
+                if (arg.is_vreg()) { group[find(group, arg.val)] = find(group, inst.dst); }
+            }
+        }
+    }
+
+    std::vector<char> read(n, 0);
+    for (auto* bb : func->blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst.op == _IR_COPY_ || inst.op == _IR_PHI_) { continue; }
+            for (int i = 0; i < (int)inst.args.size(); ++i) {
+                const Operand& arg = inst.args[i];
+                if ((inst.op == _IR_STORE_ || inst.op == _IR_FILL_ || inst.op == _IR_FREE_) && i == 0) { continue; }
+                if (arg.is_arr()) { read[find(group, func->num_vregs + arg.val)] = 1; }
+                if (arg.is_vreg()) { read[find(group, arg.val)] = 1; }
+            }
+        }
+    }
+    return read;
+};
+
+// Mark and sweep: instructions with an effect are needed, and so is the
+// definition of everything a needed instruction reads. Stores, fills and
+// frees count as an effect only when their array is read somewhere.
+static void sweep_dead_insts(IRFunction* func) {
+    std::vector<int> group;
+    std::vector<char> read = read_arrays(func, group);
+    auto base_group = [&](const Operand& base) {
+        return find(group, base.is_arr() ? func->num_vregs + base.val : base.val);
+    };
+
+    std::vector<std::pair<int, int>> def(func->num_vregs, {-1, -1});
+    std::vector<std::vector<char>> needed(func->blocks.size());
+    std::vector<int> work;
+    auto need = [&](int b, int i) {
+        needed[b][i] = 1;
+        for (auto& arg : func->blocks[b]->insts[i].args) {
+            if (arg.is_vreg()) { work.push_back(arg.val); }
+        }
+    };
+
+    for (int b = 0; b < (int)func->blocks.size(); ++b) {
+        auto& insts = func->blocks[b]->insts;
+        needed[b].assign(insts.size(), 0);
+        for (int i = 0; i < (int)insts.size(); ++i) {
+            if (insts[i].dst >= 0) { def[insts[i].dst] = {b, i}; }
+        }
+    }
+    for (int b = 0; b < (int)func->blocks.size(); ++b) {
+        auto& insts = func->blocks[b]->insts;
+        for (int i = 0; i < (int)insts.size(); ++i) {
+            const IRInst& inst = insts[i];
+            bool effect = inst.has_side_effect();
+            if (inst.op == _IR_STORE_ || inst.op == _IR_FILL_ || inst.op == _IR_FREE_) { effect = !inst.args[0].is_imm() && read[base_group(inst.args[0])]; }
+            if (effect) { need(b, i); }
+        }
+    }
+    while (!work.empty()) {
+        auto site = def[work.back()];
+        work.pop_back();
+        if (site.first >= 0 && !needed[site.first][site.second]) { need(site.first, site.second); }
+    }
+
+    for (int b = 0; b < (int)func->blocks.size(); ++b) {
+        auto& insts = func->blocks[b]->insts;
+        std::vector<IRInst> kept;
+        for (int i = 0; i < (int)insts.size(); ++i) {
+            if (needed[b][i]) { kept.push_back(insts[i]); }
+        }
+        insts = kept;
+    }
+};
+
+static void replace_pred(BasicBlock* bb, BasicBlock* from, BasicBlock* to) {
+    std::replace(bb->preds.begin(), bb->preds.end(), from, to);
+};
+
+// Folds a block into its only predecessor when that one jumps straight to
+// it, and sends edges into a block holding nothing but a jump on to its
+// target. Returns whether the cfg changed.
+static bool simplify_cfg(IRFunction* func) {
+    bool changed = false;
+    // blocks folded into their predecessor, left out of the new cfg
+    std::vector<char> gone(func->blocks.size(), 0);
+    for (auto* bb : func->blocks) {
+        while (!gone[bb->index] && bb->terminator().op == _IR_JMP_) {
+            BasicBlock* succ = bb->succs[0];
+            if (succ == bb || succ == func->blocks[0] || succ->preds.size() != 1) { break; }
+            // a phi with one way in is a copy
+            for (auto& inst : succ->insts) {
+                if (inst.op == _IR_PHI_) { inst.op = _IR_COPY_; }
+            }
+            bb->insts.pop_back();
+            bb->insts.insert(bb->insts.end(), succ->insts.begin(), succ->insts.end());
+            bb->succs = succ->succs;
+            for (auto* next : bb->succs) { replace_pred(next, succ, bb); }
+            succ->succs.clear();
+            gone[succ->index] = 1;
+            changed = true;
+        }
+    }
+
+    for (auto* bb : func->blocks) {
+        if (gone[bb->index] || bb == func->blocks[0] || bb->insts.size() != 1 || bb->terminator().op != _IR_JMP_) { continue; }
+        BasicBlock* target = bb->succs[0];
+        if (target == bb || target->insts[0].op == _IR_PHI_) { continue; }
+        for (auto* pred : bb->preds) {
+            std::replace(pred->succs.begin(), pred->succs.end(), bb, target);
+            if (pred->succs.size() == 2 && pred->succs[0] == pred->succs[1]) {
+                pred->terminator() = IRInst(_IR_JMP_, -1, {});
+                pred->succs = {target};
+            }
+            changed = true;
+        }
+        // the preds of target are stale now, rebuild_cfg sorts them out
+        bb->preds.clear();
+    }
+
+    if (changed) { func->rebuild_cfg(); }
+    return changed;
+};
+
+void eliminate_dead_code(IRModule* mod) {
+    for (auto* func : mod->funcs) {
+        sweep_dead_insts(func);
+        while (simplify_cfg(func)) {}
+    }
+};
+
+void remove_dead_functions(IRModule* mod) {
+    std::unordered_map<std::string, IRFunction*> by_name;
+    for (auto* func : mod->funcs) { by_name[func->name] = func; }
+
+    std::unordered_set<IRFunction*> reached = {mod->main_func};
+    std::vector<IRFunction*> work = {mod->main_func};
+    while (!work.empty()) {
+        IRFunction* func = work.back();
+        work.pop_back();
+        for (auto* bb : func->blocks) {
+            for (auto& inst : bb->insts) {
+                if (inst.op != _IR_CALL_) { continue; }
+                auto it = by_name.find(inst.func);
+                if (it != by_name.end() && reached.insert(it->second).second) { work.push_back(it->second); }
+            }
+        }
+    }
+
+    std::vector<IRFunction*> kept;
+    for (auto* func : mod->funcs) {
+        if (reached.count(func)) { kept.push_back(func); }
+    }
+    mod->funcs = kept;
+};
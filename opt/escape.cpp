@@ -0,0 +1,114 @@
+#include "opt.hpp"
+#include <algorithm>
+
+// Largest dynamic array that moves to the frame, and how many elements
+// those may take up together in one function
+const int MAX_STACK_ARRAY = 1024;
+const int STACK_ARRAY_BUDGET = 4096;
+
+static int find(std::vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+};
+
+// The only ways an array base can be used without the array escaping:
+// the base of an access, a bounds check, a bulk read or write, a free, or
+// joined with other versions of the same variable through a copy or phi
+static bool keeps_array(const IRInst& inst, int i) {
+    switch (inst.op) {
+        case _IR_LOAD_ :
+        case _IR_STORE_ :
+        case _IR_CHECK_ :
+        case _IR_SCAN_ARR_ :
+        case _IR_PRINT_ARR_ :
+        case _IR_FREE_ : return i == 0;
+        case _IR_COPY_ :
+        case _IR_PHI_ : return true;
+        default : return false;
+    }
+};
+
+// The versions of one array variable are the vregs joined by copies and
+// phis. When all of them come from allocations of a small constant size
+// (or the 0 the variable starts out as) and none escapes, the variable
+// gets a stack array: every allocation refills it, frees disappear and
+// accesses go to the stack array directly. Each allocation freed the one
+// before it, so the versions never need to exist at the same time.
+static void place_on_stack(IRFunction* func) {
+    int n = func->num_vregs;
+    std::vector<int> group(n);
+    for (int v = 0; v < n; ++v) { group[v] = v; }
+    for (auto* bb : func->blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst.op != _IR_COPY_ && inst.op != _IR_PHI_) { continue; }
+            for (auto& arg : inst.args) {
+                if (arg.is_vreg()) { group[find(group, arg.val)] = find(group, inst.dst); }
+            }
+        }
+    }
+
+    // per group: how many allocations, the largest one, and whether it
+    // can go on the stack at all. A bounds check compares against the
+    // size of the stack array, so checked groups need a single size.
+    std::vector<int> allocs(n, 0), size(n, 0);
+    std::vector<char> ok(n, 1), mixed(n, 0), checked(n, 0);
+    for (auto* bb : func->blocks) {
+        for (auto& inst : bb->insts) {
+            if (inst.dst >= 0) {
+                int g = find(group, inst.dst);
+                if (inst.op == _IR_ALLOC_ && inst.args[0].is_imm() && inst.args[0].val >= 0 && inst.args[0].val <= MAX_STACK_ARRAY) {
+                    mixed[g] |= allocs[g] > 0 && size[g] != inst.args[0].val;
+                    allocs[g] += 1;
+                    size[g] = std::max(size[g], (int)inst.args[0].val);
+                }
+                else if (inst.op != _IR_COPY_ && inst.op != _IR_PHI_ && !(inst.op == _IR_CONST_ && inst.args[0].val == 0)) {
+                    ok[g] = 0;
+                }
+            }
+            for (int i = 0; i < (int)inst.args.size(); ++i) {
+                if (inst.args[i].is_vreg() && !keeps_array(inst, i)) { ok[find(group, inst.args[i].val)] = 0; }
+            }
+            if (inst.op == _IR_CHECK_ && inst.args[0].is_vreg()) { checked[find(group, inst.args[0].val)] = 1; }
+        }
+    }
+
+    std::vector<int> stack_id(n, -1);
+    int budget = STACK_ARRAY_BUDGET;
+    bool placed = false;
+    for (int v = 0; v < n; ++v) {
+        if (find(group, v) != v || !ok[v] || !allocs[v] || size[v] > budget || (mixed[v] && checked[v])) { continue; }
+        budget -= size[v];
+        stack_id[v] = func->arrays.size();
+        func->arrays.push_back({"v" + std::to_string(v), size[v]});
+        placed = true;
+    }
+    if (!placed) { return; }
+
+    auto on_stack = [&](const Operand& opnd) { return opnd.is_vreg() && stack_id[find(group, opnd.val)] >= 0; };
+    for (auto* bb : func->blocks) {
+        std::vector<IRInst> kept;
+        for (auto& inst : bb->insts) {
+            if (inst.op == _IR_ALLOC_ && on_stack(Operand::vreg(inst.dst))) {
+                Operand arr = Operand::arr(stack_id[find(group, inst.dst)]);
+                kept.push_back(IRInst(_IR_FILL_, -1, {arr, inst.args[0], inst.args[1]}));
+                continue;
+            }
+            if (inst.dst >= 0 && on_stack(Operand::vreg(inst.dst))) { continue; }
+            if (inst.op == _IR_FREE_ && on_stack(inst.args[0])) { continue; }
+            if (!inst.args.empty() && on_stack(inst.args[0])) { inst.args[0] = Operand::arr(stack_id[find(group, inst.args[0].val)]); }
+            kept.push_back(inst);
+        }
+        bb->insts = kept;
+    }
+};
+
+void place_arrays_on_stack(IRModule* mod) {
+    // a frame array takes stack once per active call
+    std::vector<char> recursive = recursive_funcs(mod);
+    for (int f = 0; f < (int)mod->funcs.size(); ++f) {
+        if (!recursive[f]) { place_on_stack(mod->funcs[f]); }
+    }
+};
@@ -0,0 +1,141 @@
+#include "opt.hpp"
+#include <unordered_map>
+#include <algorithm>
+
+// Inlining stops growing a function past this many instructions
+const int MAX_INLINED_SIZE = 4000;
+
+static int func_size(IRFunction* func) {
+    int size = 0;
+    for (auto* bb : func->blocks) { size += bb->insts.size(); }
+    return size;
+};
+
+// What inlining callee adds over the call it replaces: its instructions
+// less the parameters, the call and its return
+static int inline_cost(IRFunction* callee) {
+    int cost = 0;
+    for (auto* bb : callee->blocks) {
+        for (auto& inst : bb->insts) { cost += inst.op != _IR_PARAM_ && inst.op != _IR_PHI_; }
+    }
+    return cost - 2;
+};
+
+// Replaces the call at insts[k] of blocks[b] with a copy of callee. The
+// block is split after the call: parameters become copies of the
+// arguments, returns jumps to the rest of the block, and the call's
+// result a phi over the returned values.
+static void inline_call(IRFunction* caller, int b, int k, IRFunction* callee) {
+    BasicBlock* bb = caller->blocks[b];
+    IRInst call = bb->insts[k];
+
+    BasicBlock* rest = caller->new_block(bb->loop_depth, false);
+    rest->insts.assign(bb->insts.begin() + k + 1, bb->insts.end());
+    rest->succs = bb->succs;
+    for (auto* succ : rest->succs) { std::replace(succ->preds.begin(), succ->preds.end(), bb, rest); }
+    bb->insts.erase(bb->insts.begin() + k, bb->insts.end());
+
+    int vreg_base = caller->num_vregs;
+    caller->num_vregs += callee->num_vregs;
+    int arr_base = caller->arrays.size();
+    for (auto& arr : callee->arrays) { caller->arrays.push_back({callee->name + "_" + arr.name, arr.size}); }
+    auto remap = [&](Operand opnd) {
+        if (opnd.is_vreg()) { opnd.val += vreg_base; }
+        if (opnd.is_arr()) { opnd.val += arr_base; }
+        return opnd;
+    };
+
+    std::unordered_map<BasicBlock*, BasicBlock*> copy;
+    std::vector<BasicBlock*> clones;
+    for (auto* cb : callee->blocks) {
+        clones.push_back(caller->new_block(cb->loop_depth + bb->loop_depth, false));
+        copy[cb] = clones.back();
+    }
+
+    std::vector<Operand> results;
+    for (auto* cb : callee->blocks) {
+        BasicBlock* nb = copy[cb];
+        for (auto* succ : cb->succs) { nb->succs.push_back(copy[succ]); }
+        for (auto* pred : cb->preds) { nb->preds.push_back(copy[pred]); }
+        for (auto& inst : cb->insts) {
+            IRInst clone = inst;
+            if (clone.dst >= 0) { clone.dst += vreg_base; }
+            for (auto& arg : clone.args) { arg = remap(arg); }
+            if (inst.op == _IR_PARAM_) { clone = IRInst(_IR_COPY_, inst.dst + vreg_base, {call.args[inst.args[0].val]}); }
+            if (inst.op == _IR_RET_) {
+                results.push_back(clone.args[0]);
+                rest->preds.push_back(nb);
+                nb->succs = {rest};
+                clone = IRInst(_IR_JMP_, -1, {});
+            }
+            nb->insts.push_back(clone);
+        }
+    }
+
+    // a callee that never returns leaves the rest unreachable
+    if (call.dst >= 0 && !results.empty()) {
+        IROp op = results.size() == 1 ? _IR_COPY_ : _IR_PHI_;
+        rest->insts.insert(rest->insts.begin(), IRInst(op, call.dst, results));
+    }
+
+    bb->insts.push_back(IRInst(_IR_JMP_, -1, {}));
+    bb->succs = {clones[0]};
+    clones[0]->preds = {bb};
+
+    clones.push_back(rest);
+    caller->blocks.insert(caller->blocks.begin() + b + 1, clones.begin(), clones.end());
+    caller->rebuild_cfg();
+};
+
+// Callees go first, so what gets inlined has had its own calls inlined
+static void post_order(int f, const std::vector<std::vector<int>>& callees, std::vector<char>& seen, std::vector<int>& order) {
+    seen[f] = 1;
+    for (int g : callees[f]) {
+        if (!seen[g]) { post_order(g, callees, seen, order); }
+    }
+    order.push_back(f);
+};
+
+void inline_calls(IRModule* mod, int threshold) {
+    if (threshold <= 0) { return; }
+
+    std::unordered_map<std::string, IRFunction*> by_name;
+    for (auto* func : mod->funcs) { by_name[func->name] = func; }
+    std::vector<char> recursive = recursive_funcs(mod);
+    std::vector<std::vector<int>> callees = call_graph(mod);
+
+    std::vector<char> seen(mod->funcs.size(), 0);
+    std::vector<int> order;
+    for (int f = 0; f < (int)mod->funcs.size(); ++f) {
+        if (!seen[f]) { post_order(f, callees, seen, order); }
+    }
+
+    // whether calls to a function may be replaced by its body
+    std::unordered_map<IRFunction*, bool> inlinable;
+    for (int f = 0; f < (int)mod->funcs.size(); ++f) {
+        IRFunction* func = mod->funcs[f];
+        inlinable[func] = !recursive[f] && func != mod->main_func && func->blocks[0]->preds.empty();
+    }
+
+    for (int f : order) {
+        IRFunction* caller = mod->funcs[f];
+        int size = func_size(caller);
+        for (int b = 0; b < (int)caller->blocks.size(); ++b) {
+            auto& insts = caller->blocks[b]->insts;
+            for (int k = 0; k < (int)insts.size(); ++k) {
+                if (insts[k].op != _IR_CALL_) { continue; }
+                auto it = by_name.find(insts[k].func);
+                if (it == by_name.end() || !inlinable[it->second]) { continue; }
+                IRFunction* callee = it->second;
+                if ((int)insts[k].args.size() != callee->num_params || inline_cost(callee) > threshold) { continue; }
+                int added = func_size(callee);
+                if (size + added > MAX_INLINED_SIZE) { continue; }
+
+                inline_call(caller, b, k, callee);
+                size += added;
+                // the callee's blocks follow, calls left in them get their turn
+                break;
+            }
+        }
+    }
+};
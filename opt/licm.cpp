@@ -0,0 +1,204 @@
+#include "opt.hpp"
+#include <algorithm>
+
+struct Loop {
+    BasicBlock* header;
+    // indexed like IRFunction::blocks
+    std::vector<char> body;
+    int size = 0;
+};
+
+static bool dominates(const std::vector<int>& idom, int a, int b) {
+    while (b != a && b != 0) { b = idom[b]; }
+    return b == a;
+};
+
+// Natural loops, one per header with all its back edges merged, innermost
+// first
+static std::vector<Loop> find_loops(IRFunction* func, const std::vector<int>& idom) {
+    int n = func->blocks.size();
+    std::vector<Loop> loops;
+    std::vector<int> loop_of(n, -1);
+    for (auto* bb : func->blocks) {
+        for (auto* succ : bb->succs) {
+            if (!dominates(idom, succ->index, bb->index)) { continue; }
+            if (loop_of[succ->index] < 0) {
+                loop_of[succ->index] = loops.size();
+                loops.push_back({succ, std::vector<char>(n, 0)});
+                loops.back().body[succ->index] = 1;
+            }
+            Loop& loop = loops[loop_of[succ->index]];
+            std::vector<BasicBlock*> work = {bb};
+            while (!work.empty()) {
+                BasicBlock* cur = work.back();
+                work.pop_back();
+                if (loop.body[cur->index]) { continue; }
+                loop.body[cur->index] = 1;
+                for (auto* pred : cur->preds) { work.push_back(pred); }
+            }
+        }
+    }
+    for (auto& loop : loops) { loop.size = std::count(loop.body.begin(), loop.body.end(), 1); }
+    std::stable_sort(loops.begin(), loops.end(), [](const Loop& a, const Loop& b) { return a.size < b.size; });
+    return loops;
+};
+
+// Division can trap and a load can fault on an index the loop would have
+// checked first, so those only move when they run on every iteration
+static bool may_trap(const IRInst& inst) {
+    switch (inst.op) {
+        case _IR_DIV_ :
+        case _IR_MOD_ : return !inst.args[1].is_imm() || inst.args[1].val == 0 || inst.args[1].val == -1;
+        case _IR_LOAD_ : return true;
+        default : return false;
+    }
+};
+
+static bool can_move(const IRInst& inst) {
+    switch (inst.op) {
+        case _IR_PHI_ :
+        case _IR_PARAM_ :
+        case _IR_ALLOC_ :
+        case _IR_SCAN_ :
+        case _IR_CALL_ : return false;
+        default : return inst.dst >= 0 && !inst.has_side_effect();
+    }
+};
+
+// Block that runs once right before the loop is entered: the one
+// predecessor from outside when it leads nowhere else, a new block
+// otherwise. Phis of the header with several ways in from outside get a
+// phi in the new block to merge those. A new block goes at the end of
+// blocks so the indices the loops and idom hold stay valid; both are
+// extended for it here and the caller puts it in place afterwards.
+static BasicBlock* preheader(IRFunction* func, Loop& loop, std::vector<Loop>& loops, std::vector<int>& idom) {
+    BasicBlock* header = loop.header;
+    std::vector<int> inside, outside;
+    for (int j = 0; j < (int)header->preds.size(); ++j) {
+        (loop.body[header->preds[j]->index] ? inside : outside).push_back(j);
+    }
+    if (outside.size() == 1 && header->preds[outside[0]]->succs.size() == 1) { return header->preds[outside[0]]; }
+
+    BasicBlock* pre = func->new_block(std::max(0, header->loop_depth - 1), true);
+    pre->index = func->blocks.size() - 1;
+    idom.push_back(idom[header->index]);
+    idom[header->index] = pre->index;
+    for (auto& other : loops) { other.body.push_back(&other != &loop && other.body[header->index]); }
+    for (int j : outside) { pre->preds.push_back(header->preds[j]); }
+
+    for (auto& inst : header->insts) {
+        if (inst.op != _IR_PHI_) { break; }
+        std::vector<Operand> from_outside;
+        for (int j : outside) { from_outside.push_back(inst.args[j]); }
+        Operand val = from_outside[0];
+        if (std::count(from_outside.begin(), from_outside.end(), val) != (int)from_outside.size()) {
+            val = Operand::vreg(func->new_vreg());
+            pre->insts.push_back(IRInst(_IR_PHI_, val.val, from_outside));
+        }
+        std::vector<Operand> args;
+        for (int j : inside) { args.push_back(inst.args[j]); }
+        args.push_back(val);
+        inst.args = args;
+    }
+    pre->insts.push_back(IRInst(_IR_JMP_, -1, {}));
+    pre->succs = {header};
+
+    for (auto* pred : pre->preds) { std::replace(pred->succs.begin(), pred->succs.end(), header, pre); }
+    std::vector<BasicBlock*> preds;
+    for (int j : inside) { preds.push_back(header->preds[j]); }
+    preds.push_back(pre);
+    header->preds = preds;
+    return pre;
+};
+
+// Moves what loop computes the same way on every iteration in front of
+// it. Returns whether anything moved.
+static bool hoist_loop(IRFunction* func, Loop& loop, std::vector<Loop>& loops, std::vector<int>& idom) {
+    std::vector<char> inside(func->num_vregs, 0);
+    std::vector<int> exits;
+    bool stores_dyn = false;
+    // a load moved ahead of its bounds check could fault before the check
+    // reports the bad index
+    bool checks = false;
+    std::vector<char> stored(func->arrays.size(), 0);
+    for (auto* bb : func->blocks) {
+        if (!loop.body[bb->index]) { continue; }
+        for (auto& inst : bb->insts) {
+            if (inst.dst >= 0) { inside[inst.dst] = 1; }
+            if (inst.op == _IR_CHECK_) { checks = true; }
+            if (inst.op != _IR_STORE_ && inst.op != _IR_FILL_ && inst.op != _IR_SCAN_ARR_) { continue; }
+            if (inst.args[0].is_arr()) { stored[inst.args[0].val] = 1; }
+            else { stores_dyn = true; }
+        }
+        for (auto* succ : bb->succs) {
+            if (!loop.body[succ->index]) {
+                exits.push_back(bb->index);
+                break;
+            }
+        }
+    }
+
+    // (block, instruction) in the order they can run in the preheader
+    std::vector<std::pair<BasicBlock*, int>> moved;
+    std::vector<char> hoisted(func->num_vregs, 0);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto* bb : func->blocks) {
+            if (!loop.body[bb->index]) { continue; }
+            bool every_iteration = exits.empty() ? bb == loop.header : std::all_of(exits.begin(), exits.end(), [&](int e) { return dominates(idom, bb->index, e); });
+            for (int i = 0; i < (int)bb->insts.size(); ++i) {
+                IRInst& inst = bb->insts[i];
+                if (!can_move(inst) || hoisted[inst.dst]) { continue; }
+                if (may_trap(inst) && !every_iteration) { continue; }
+                if (inst.op == _IR_LOAD_) {
+                    const Operand& base = inst.args[0];
+                    if (checks || (base.is_arr() ? stored[base.val] : stores_dyn)) { continue; }
+                }
+                bool invariant = std::all_of(inst.args.begin(), inst.args.end(), [&](const Operand& arg) {
+                    return !arg.is_vreg() || !inside[arg.val] || hoisted[arg.val];
+                });
+                if (!invariant) { continue; }
+                hoisted[inst.dst] = 1;
+                moved.push_back({bb, i});
+                changed = true;
+            }
+        }
+    }
+    if (moved.empty()) { return false; }
+
+    std::vector<IRInst> code;
+    for (auto& site : moved) { code.push_back(site.first->insts[site.second]); }
+    for (auto* bb : func->blocks) {
+        if (!loop.body[bb->index]) { continue; }
+        auto& insts = bb->insts;
+        insts.erase(std::remove_if(insts.begin(), insts.end(), [&](const IRInst& inst) { return inst.dst >= 0 && hoisted[inst.dst]; }), insts.end());
+    }
+
+    BasicBlock* pre = preheader(func, loop, loops, idom);
+    pre->insts.insert(pre->insts.end() - 1, code.begin(), code.end());
+    return true;
+};
+
+void hoist_loop_invariants(IRModule* mod) {
+    for (auto* func : mod->funcs) {
+        int n = func->blocks.size();
+        std::vector<int> idom = compute_idoms(func);
+        std::vector<Loop> loops = find_loops(func, idom);
+        bool changed = false;
+        for (auto& loop : loops) {
+            if (loop.header != func->blocks[0]) { changed |= hoist_loop(func, loop, loops, idom); }
+        }
+        if (!changed) { continue; }
+
+        // new preheaders move from the end to right before their header
+        std::vector<BasicBlock*> order, before(n, nullptr);
+        for (int i = n; i < (int)func->blocks.size(); ++i) { before[func->blocks[i]->succs[0]->index] = func->blocks[i]; }
+        for (int i = 0; i < n; ++i) {
+            if (before[i]) { order.push_back(before[i]); }
+            order.push_back(func->blocks[i]);
+        }
+        func->blocks = order;
+        func->rebuild_cfg();
+    }
+};
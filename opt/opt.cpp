@@ -0,0 +1,49 @@
+#include "opt.hpp"
+#include <unordered_map>
+
+void optimize_module(IRModule* mod, SimdISA isa, BoundsMode bounds, int inline_threshold) {
+    optimize_tail_calls(mod);
+    inline_calls(mod, inline_threshold);
+    fold_constants(mod);
+    place_arrays_on_stack(mod);
+    if (bounds == _BOUNDS_ELIDED_) { elide_bounds_checks(mod); }
+    eliminate_dead_code(mod);
+    hoist_loop_invariants(mod);
+    vectorize_loops(mod, isa);
+    remove_dead_functions(mod);
+};
+
+std::vector<std::vector<int>> call_graph(IRModule* mod) {
+    std::unordered_map<std::string, int> by_name;
+    for (int f = 0; f < (int)mod->funcs.size(); ++f) { by_name[mod->funcs[f]->name] = f; }
+
+    std::vector<std::vector<int>> callees(mod->funcs.size());
+    for (int f = 0; f < (int)mod->funcs.size(); ++f) {
+        for (auto* bb : mod->funcs[f]->blocks) {
+            for (auto& inst : bb->insts) {
+                auto it = inst.op == _IR_CALL_ ? by_name.find(inst.func) : by_name.end();
+                if (it != by_name.end()) { callees[f].push_back(it->second); }
+            }
+        }
+    }
+    return callees;
+};
+
+std::vector<char> recursive_funcs(IRModule* mod) {
+    std::vector<std::vector<int>> callees = call_graph(mod);
+    int n = mod->funcs.size();
+    std::vector<char> recursive(n, 0);
+    for (int f = 0; f < n; ++f) {
+        std::vector<char> seen(n, 0);
+        std::vector<int> work = callees[f];
+        while (!work.empty() && !recursive[f]) {
+            int g = work.back();
+            work.pop_back();
+            if (g == f) { recursive[f] = 1; }
+            if (seen[g]) { continue; }
+            seen[g] = 1;
+            work.insert(work.end(), callees[g].begin(), callees[g].end());
+        }
+    }
+    return recursive;
+};
@@ -0,0 +1,61 @@
+#include "../ir/ir.hpp"
+
+#ifndef OPT_HPP
+#define OPT_HPP
+
+// Runs the optimization passes over every function of mod, which must be
+// in SSA form; loops are vectorized for isa, bounds checks are elided when
+// bounds asks for it and calls are inlined up to inline_threshold
+void optimize_module(IRModule* mod, SimdISA isa, BoundsMode bounds, int inline_threshold);
+
+// Callees of every function of mod->funcs, as indices into it
+std::vector<std::vector<int>> call_graph(IRModule* mod);
+
+// Which functions of mod->funcs can end up calling themselves
+std::vector<char> recursive_funcs(IRModule* mod);
+
+// Turns calls of a function to itself whose result it returns into a loop
+// back to the top, and moves the frees that follow a call whose result is
+// returned ahead of it so the backend can jump to the callee instead
+void optimize_tail_calls(IRModule* mod);
+
+// Replaces calls to non-recursive functions by a copy of their body when
+// that adds at most threshold instructions over the call, callees before
+// their callers; 0 turns inlining off
+void inline_calls(IRModule* mod, int threshold);
+
+// Sparse conditional constant propagation across the whole program:
+// constants flow through phis, into parameters every call passes the same
+// constant to and out of functions that always return one. Uses of a
+// constant vreg become immediates and branches with a known outcome jumps.
+void fold_constants(IRModule* mod);
+
+// Drops instructions whose result nothing needs, including stores into
+// arrays that are never read, then folds away blocks that only pass
+// control on
+void eliminate_dead_code(IRModule* mod);
+
+// Gives dynamic arrays of a small constant size that never escape a
+// non-recursive function a slot in its frame instead of the heap
+void place_arrays_on_stack(IRModule* mod);
+
+// Drops the bounds checks that the branches leading to them already
+// decide: constant indices into arrays of a known length, and loop
+// counters that start at zero or above and only continue while below
+// the length the array was allocated with
+void elide_bounds_checks(IRModule* mod);
+
+// Moves computations that give the same result on every iteration of a
+// loop, loads from arrays the loop never stores to included, into a block
+// run once before the loop
+void hoist_loop_invariants(IRModule* mod);
+
+// Turns single-block counted loops that work element by element on arrays
+// (every access at the loop counter) into vector code for isa, the
+// original loop finishing off what does not fill a whole vector
+void vectorize_loops(IRModule* mod, SimdISA isa);
+
+// Drops the functions main can never reach through calls
+void remove_dead_functions(IRModule* mod);
+
+#endif
@@ -0,0 +1,90 @@
+#include "opt.hpp"
+#include <algorithm>
+
+// Position of the call whose result insts returns, -1 when there is none.
+// Frees of the function's own arrays may sit in between; they move ahead
+// of the call, which cannot reach those arrays anyway.
+static int tail_call(std::vector<IRInst>& insts) {
+    IRInst& ret = insts.back();
+    if (ret.op != _IR_RET_ || !ret.args[0].is_vreg()) { return -1; }
+
+    int k = insts.size() - 2;
+    while (k >= 0 && insts[k].op == _IR_FREE_) { --k; }
+    if (k < 0 || insts[k].op != _IR_CALL_ || insts[k].dst != ret.args[0].val) { return -1; }
+    for (int i = k + 1; i < (int)insts.size() - 1; ++i) {
+        const IRInst& free = insts[i];
+        if (std::find(insts[k].args.begin(), insts[k].args.end(), free.args[0]) != insts[k].args.end()) { return -1; }
+    }
+
+    std::rotate(insts.begin() + k, insts.begin() + k + 1, insts.end() - 1);
+    return insts.size() - 2;
+};
+
+// Calls to the function itself whose result it returns become jumps back
+// to a header after the parameters, where a phi per parameter takes the
+// arguments. The blocks on the way from the header to those jumps form
+// the new loop.
+static void loop_self_calls(IRFunction* func, const std::vector<BasicBlock*>& tails) {
+    BasicBlock* entry = func->blocks[0];
+    BasicBlock* header = func->new_block(entry->loop_depth, false);
+
+    auto first = std::find_if(entry->insts.begin(), entry->insts.end(), [](const IRInst& inst) { return inst.op != _IR_PARAM_; });
+    header->insts.assign(first, entry->insts.end());
+    entry->insts.erase(first, entry->insts.end());
+    header->succs = entry->succs;
+    for (auto* succ : header->succs) { std::replace(succ->preds.begin(), succ->preds.end(), entry, header); }
+    std::vector<BasicBlock*> jumps = tails;
+    std::replace(jumps.begin(), jumps.end(), entry, header);
+
+    // each parameter arrives in a fresh vreg, its old one is now the phi
+    std::vector<IRInst> phis;
+    for (auto& param : entry->insts) {
+        phis.push_back(IRInst(_IR_PHI_, param.dst, {}));
+        param.dst = func->new_vreg();
+        phis.back().args.push_back(Operand::vreg(param.dst));
+    }
+    entry->insts.push_back(IRInst(_IR_JMP_, -1, {}));
+    entry->succs = {header};
+    header->preds = {entry};
+
+    for (auto* bb : jumps) {
+        IRInst call = bb->insts[bb->insts.size() - 2];
+        for (int p = 0; p < (int)entry->insts.size() - 1; ++p) {
+            phis[p].args.push_back(call.args[entry->insts[p].args[0].val]);
+        }
+        bb->insts.pop_back();
+        bb->insts.back() = IRInst(_IR_JMP_, -1, {});
+        bb->succs = {header};
+        header->preds.push_back(bb);
+    }
+    header->insts.insert(header->insts.begin(), phis.begin(), phis.end());
+
+    std::vector<BasicBlock*> in_loop;
+    std::vector<BasicBlock*> work = jumps;
+    while (!work.empty()) {
+        BasicBlock* bb = work.back();
+        work.pop_back();
+        if (std::find(in_loop.begin(), in_loop.end(), bb) != in_loop.end()) { continue; }
+        in_loop.push_back(bb);
+        for (auto* pred : bb->preds) {
+            if (pred != entry) { work.push_back(pred); }
+        }
+    }
+    for (auto* bb : in_loop) { bb->loop_depth += 1; }
+
+    func->blocks.insert(func->blocks.begin() + 1, header);
+    func->rebuild_cfg();
+};
+
+void optimize_tail_calls(IRModule* mod) {
+    for (auto* func : mod->funcs) {
+        if (func == mod->main_func || !func->blocks[0]->preds.empty()) { continue; }
+
+        std::vector<BasicBlock*> tails;
+        for (auto* bb : func->blocks) {
+            int k = tail_call(bb->insts);
+            if (k >= 0 && bb->insts[k].func == func->name && (int)bb->insts[k].args.size() == func->num_params) { tails.push_back(bb); }
+        }
+        if (!tails.empty()) { loop_self_calls(func, tails); }
+    }
+};
@@ -0,0 +1,461 @@
+#include "opt.hpp"
+#include <algorithm>
+
+// xmm13 to xmm15 are left to the backend for scratch
+const int NUM_VEC_REGS = 13;
+
+static int lanes(SimdISA isa) {
+    return isa == _SIMD_AVX2_ ? 4 : 2;
+};
+
+static Tag negate(Tag cc) {
+    switch (cc) {
+        case _LESS_ : return _GEQ_;
+        case _GREAT_ : return _LEQ_;
+        case _EQ_ : return _NEQ_;
+        case _NEQ_ : return _EQ_;
+        case _LEQ_ : return _GREAT_;
+        case _GEQ_ : return _LESS_;
+        default : return cc;
+    }
+};
+
+static Tag swap(Tag cc) {
+    switch (cc) {
+        case _LESS_ : return _GREAT_;
+        case _GREAT_ : return _LESS_;
+        case _LEQ_ : return _GEQ_;
+        case _GEQ_ : return _LEQ_;
+        default : return cc;
+    }
+};
+
+// Loop made of one block that runs with iv from start and goes round again
+// while next = iv + 1 is below bound (or at most bound when inclusive).
+// It may carry one reduction red = red op x, red_next being the new value.
+struct CountedLoop {
+    BasicBlock* header;
+    BasicBlock* pre;
+    BasicBlock* exit;
+    // index of the back edge in header->preds
+    int back;
+    int iv = -1;
+    int next = -1;
+    Operand start;
+    Operand bound;
+    bool inclusive = false;
+    int red = -1;
+    int red_next = -1;
+    Operand red_start;
+};
+
+static int count_uses(BasicBlock* bb, int vreg) {
+    int uses = 0;
+    for (auto& inst : bb->insts) {
+        uses += std::count(inst.args.begin(), inst.args.end(), Operand::vreg(vreg));
+    }
+    return uses;
+};
+
+// defined marks the vregs bb defines
+static bool match_loop(BasicBlock* bb, const std::vector<char>& defined, CountedLoop& loop) {
+    IRInst& br = bb->terminator();
+    if (br.op != _IR_BR_ || bb->preds.size() != 2 || bb->succs[0] == bb->succs[1]) { return false; }
+    bool stay_taken = bb->succs[0] == bb;
+    if (!stay_taken && bb->succs[1] != bb) { return false; }
+    loop.header = bb;
+    loop.exit = bb->succs[stay_taken ? 1 : 0];
+    loop.back = bb->preds[0] == bb ? 0 : 1;
+    loop.pre = bb->preds[1 - loop.back];
+    if (loop.pre == bb) { return false; }
+
+    Operand a = br.args[0], b = br.args[1];
+    Tag cc = stay_taken ? br.cc : negate(br.cc);
+    if (b.is_vreg() && defined[b.val]) {
+        std::swap(a, b);
+        cc = swap(cc);
+    }
+    if (!a.is_vreg() || !defined[a.val] || (b.is_vreg() && defined[b.val])) { return false; }
+    if (cc != _LESS_ && cc != _LEQ_) { return false; }
+    loop.inclusive = cc == _LEQ_;
+    loop.bound = b;
+    loop.next = a.val;
+
+    for (auto& inst : bb->insts) {
+        if (inst.dst != loop.next) { continue; }
+        if (inst.op != _IR_ADD_) { return false; }
+        Operand x = inst.args[0], y = inst.args[1];
+        if (x.is_imm()) { std::swap(x, y); }
+        if (!x.is_vreg() || !y.is_imm() || y.val != 1) { return false; }
+        loop.iv = x.val;
+    }
+
+    // every phi is the counter or the reduction
+    for (auto& inst : bb->insts) {
+        if (inst.op != _IR_PHI_) { break; }
+        const Operand& from_back = inst.args[loop.back];
+        const Operand& from_pre = inst.args[1 - loop.back];
+        if (inst.dst == loop.iv) {
+            if (from_back != Operand::vreg(loop.next)) { return false; }
+            loop.start = from_pre;
+            continue;
+        }
+        if (loop.red >= 0 || !from_back.is_vreg() || !defined[from_back.val]) { return false; }
+        loop.red = inst.dst;
+        loop.red_next = from_back.val;
+        loop.red_start = from_pre;
+    }
+    if (loop.start.kind == _OPND_NONE_) { return false; }
+    if (count_uses(bb, loop.next) != 2 || count_uses(bb, loop.iv) < 1) { return false; }
+    if (loop.red < 0) { return true; }
+
+    for (auto& inst : bb->insts) {
+        if (inst.dst != loop.red_next) { continue; }
+        bool commutes = inst.op == _IR_ADD_ || inst.op == _IR_AND_ || inst.op == _IR_OR_;
+        if (!commutes && inst.op != _IR_SUB_) { return false; }
+        if (inst.args[0] != Operand::vreg(loop.red) && !(commutes && inst.args[1] == Operand::vreg(loop.red))) { return false; }
+    }
+    return count_uses(bb, loop.red) == 1 && count_uses(bb, loop.red_next) == 1;
+};
+
+// Vector form of the body of loop for isa, false when some instruction
+// has none. args[1] of the kernel is left for the caller to fill in.
+static bool build_kernel(IRFunction* func, const CountedLoop& loop, const std::vector<char>& defined, SimdISA isa, IRInst& kernel) {
+    BasicBlock* bb = loop.header;
+    kernel.args = {loop.start, Operand(), loop.red >= 0 ? loop.red_start : Operand::imm(0)};
+    VecLoop* vec = kernel.vec = ast_arena.make<VecLoop>();
+    vec->isa = isa;
+
+    std::vector<int> last(func->num_vregs, -1);
+    for (int i = 0; i < (int)bb->insts.size(); ++i) {
+        for (auto& arg : bb->insts[i].args) {
+            if (arg.is_vreg()) { last[arg.val] = i; }
+        }
+    }
+
+    bool ok = true;
+    bool touches_memory = false;
+    // registers live through the whole loop come from the bottom and must
+    // not have held anything in the body, temporaries come from the top
+    std::vector<char> busy(NUM_VEC_REGS, 0), fixed(NUM_VEC_REGS, 0), held(NUM_VEC_REGS, 0);
+    std::vector<int> reg_of(func->num_vregs, -1);
+    std::vector<std::pair<Operand, int>> splatted;
+    auto take = [&]() {
+        for (int r = NUM_VEC_REGS - 1; r >= 0; --r) {
+            if (!busy[r]) {
+                busy[r] = held[r] = 1;
+                return r;
+            }
+        }
+        ok = false;
+        return 0;
+    };
+    auto take_fixed = [&]() {
+        for (int r = 0; r < NUM_VEC_REGS; ++r) {
+            if (!busy[r] && !held[r]) {
+                busy[r] = fixed[r] = 1;
+                return r;
+            }
+        }
+        ok = false;
+        return 0;
+    };
+    auto arg_of = [&](const Operand& opnd) {
+        auto it = std::find(kernel.args.begin() + 3, kernel.args.end(), opnd);
+        if (it != kernel.args.end()) { return (int)(it - kernel.args.begin()); }
+        kernel.args.push_back(opnd);
+        return (int)kernel.args.size() - 1;
+    };
+    auto splat = [&](const Operand& opnd) {
+        for (auto& s : splatted) {
+            if (s.first == opnd) { return s.second; }
+        }
+        int r = take_fixed();
+        vec->splats.push_back({r, arg_of(opnd)});
+        splatted.push_back({opnd, r});
+        return r;
+    };
+    auto value = [&](const Operand& opnd) {
+        if (!opnd.is_vreg() || !defined[opnd.val]) { return splat(opnd); }
+        if (opnd.val == loop.iv) {
+            if (vec->index < 0) { vec->index = take_fixed(); }
+            return vec->index;
+        }
+        if (reg_of[opnd.val] < 0) { ok = false; }
+        return std::max(reg_of[opnd.val], 0);
+    };
+    auto invariant = [&](const Operand& opnd) { return !opnd.is_vreg() || !defined[opnd.val]; };
+
+    if (loop.red >= 0) { vec->acc = take_fixed(); }
+
+    for (int i = 0; i < (int)bb->insts.size() && ok; ++i) {
+        IRInst& inst = bb->insts[i];
+        if (inst.op == _IR_PHI_ || inst.is_terminator() || inst.dst == loop.next) { continue; }
+        const std::vector<Operand>& args = inst.args;
+        VecOp op;
+        op.op = inst.op;
+        op.cc = inst.cc;
+
+        bool reduction = inst.dst >= 0 && inst.dst == loop.red_next;
+        if (reduction) {
+            op.dst = op.a = vec->acc;
+            op.b = value(args[0] == Operand::vreg(loop.red) ? args[1] : args[0]);
+            vec->reduce = inst.op == _IR_SUB_ ? _IR_ADD_ : inst.op;
+        }
+        else {
+            switch (inst.op) {
+                case _IR_LOAD_ : {
+                    if (args[1] != Operand::vreg(loop.iv) || !invariant(args[0])) { return false; }
+                    op.a = arg_of(args[0]);
+                    touches_memory = true;
+                    break;
+                }
+                case _IR_STORE_ : {
+                    if (args[1] != Operand::vreg(loop.iv) || !invariant(args[0])) { return false; }
+                    op.a = arg_of(args[0]);
+                    op.b = value(args[2]);
+                    touches_memory = true;
+                    break;
+                }
+                case _IR_CONST_ : {
+                    reg_of[inst.dst] = splat(args[0]);
+                    continue;
+                }
+                case _IR_MUL_ : {
+                    Operand x = args[0], y = args[1];
+                    if (x.is_imm()) { std::swap(x, y); }
+                    if (y.is_imm() && y.val > 0 && (y.val & (y.val - 1)) == 0) {
+                        op.op = _IR_SHL_;
+                        op.a = value(x);
+                        op.b = __builtin_ctzll(y.val);
+                    }
+                    else {
+                        op.a = value(x);
+                        op.b = value(y);
+                    }
+                    break;
+                }
+                case _IR_SHL_ : {
+                    if (!args[1].is_imm()) { return false; }
+                    op.a = value(args[0]);
+                    op.b = args[1].val & 63;
+                    break;
+                }
+                case _IR_ADD_ :
+                case _IR_SUB_ :
+                case _IR_AND_ :
+                case _IR_OR_ :
+                case _IR_CMP_ : {
+                    op.a = value(args[0]);
+                    op.b = value(args[1]);
+                    break;
+                }
+                case _IR_NOT_ :
+                case _IR_NEG_ :
+                case _IR_COPY_ : {
+                    op.a = value(args[0]);
+                    break;
+                }
+                default : return false;
+            }
+        }
+
+        // operands dying here hand their registers on, the result may
+        // take one of them
+        for (auto& arg : args) {
+            if (arg.is_vreg() && defined[arg.val] && last[arg.val] == i && reg_of[arg.val] >= 0 && !fixed[reg_of[arg.val]]) { busy[reg_of[arg.val]] = 0; }
+        }
+        if (inst.dst >= 0 && !reduction) {
+            op.dst = reg_of[inst.dst] = take();
+            if (last[inst.dst] < 0) { busy[op.dst] = 0; }
+        }
+        vec->body.push_back(op);
+    }
+
+    if (vec->index >= 0) {
+        int step = splat(Operand::imm(lanes(isa)));
+        vec->body.push_back({_IR_ADD_, vec->index, vec->index, step, _EQ_});
+    }
+    return ok && (touches_memory || loop.red >= 0);
+};
+
+// Runs the loop's iterations a vector at a time first and leaves the rest
+// to the loop itself. For every kernel a guard works out where whole
+// vectors end and skips to the scalar loop when there are none; under
+// dispatch the cpu's SIMD level picks the kernel.
+static void vectorize_loop(IRFunction* func, CountedLoop& loop, std::vector<IRInst>& kernels, bool dispatch) {
+    BasicBlock* header = loop.header;
+    int depth = std::max(0, header->loop_depth - 1);
+    std::vector<BasicBlock*> added;
+    auto make_block = [&]() {
+        BasicBlock* bb = func->new_block(depth, false);
+        added.push_back(bb);
+        return bb;
+    };
+    auto put = [](BasicBlock* bb, IROp op, int dst, std::vector<Operand> args, Tag cc = _EQ_) {
+        bb->insts.push_back(IRInst(op, dst, args));
+        bb->insts.back().cc = cc;
+    };
+    auto vreg = [&]() { return Operand::vreg(func->new_vreg()); };
+
+    // (block, counter, reduction) for every new way into the loop and out
+    // of the kernels
+    std::vector<std::tuple<BasicBlock*, Operand, Operand>> into_loop, out_of_kernels;
+    BasicBlock* head = make_block();
+    Operand hi = loop.bound;
+    if (loop.inclusive) {
+        hi = vreg();
+        put(head, _IR_ADD_, hi.val, {loop.bound, Operand::imm(1)});
+    }
+    Operand level;
+    if (dispatch) {
+        level = vreg();
+        put(head, _IR_SIMD_, level.val, {});
+    }
+
+    BasicBlock* check = head;
+    for (int k = 0; k < (int)kernels.size(); ++k) {
+        IRInst& kernel = kernels[k];
+        BasicBlock* guard = check;
+        if (dispatch) {
+            guard = make_block();
+            BasicBlock* other = k + 1 < (int)kernels.size() ? make_block() : header;
+            put(check, _IR_BR_, -1, {level, Operand::imm(kernel.vec->isa)});
+            check->succs = {guard, other};
+            if (other == header) { into_loop.push_back({check, loop.start, loop.red_start}); }
+            check = other;
+        }
+
+        Operand count = vreg(), whole = vreg(), end = vreg();
+        put(guard, _IR_SUB_, count.val, {hi, loop.start});
+        put(guard, _IR_AND_, whole.val, {count, Operand::imm(-lanes(kernel.vec->isa))});
+        put(guard, _IR_ADD_, end.val, {loop.start, whole});
+        BasicBlock* body = make_block();
+        put(guard, _IR_BR_, -1, {loop.start, end}, _LESS_);
+        guard->succs = {body, header};
+        into_loop.push_back({guard, loop.start, loop.red_start});
+
+        kernel.args[1] = end;
+        Operand red = Operand::imm(0);
+        if (loop.red >= 0) {
+            red = vreg();
+            kernel.dst = red.val;
+        }
+        body->insts.push_back(kernel);
+        put(body, _IR_BR_, -1, {end, hi}, _LESS_);
+        into_loop.push_back({body, end, red});
+        out_of_kernels.push_back({body, end, red});
+    }
+
+    BasicBlock* done = make_block();
+    Operand fin = std::get<1>(out_of_kernels[0]), red_fin = std::get<2>(out_of_kernels[0]);
+    for (auto& out : out_of_kernels) { done->preds.push_back(std::get<0>(out)); }
+    if (out_of_kernels.size() > 1) {
+        std::vector<Operand> ends, reds;
+        for (auto& out : out_of_kernels) {
+            ends.push_back(std::get<1>(out));
+            reds.push_back(std::get<2>(out));
+        }
+        fin = vreg();
+        put(done, _IR_PHI_, fin.val, ends);
+        if (loop.red >= 0) {
+            red_fin = vreg();
+            put(done, _IR_PHI_, red_fin.val, reds);
+        }
+    }
+    for (auto& out : out_of_kernels) { std::get<0>(out)->succs = {header, done}; }
+    put(done, _IR_JMP_, -1, {});
+    done->succs = {loop.exit};
+
+    // the loop's phis take the counter and the reduction from every new way in
+    for (auto& inst : header->insts) {
+        if (inst.op != _IR_PHI_) { break; }
+        std::vector<Operand> args = {inst.args[loop.back]};
+        for (auto& in : into_loop) { args.push_back(inst.dst == loop.iv ? std::get<1>(in) : std::get<2>(in)); }
+        inst.args = args;
+    }
+    std::vector<BasicBlock*> preds = {header};
+    for (auto& in : into_loop) { preds.push_back(std::get<0>(in)); }
+    header->preds = preds;
+    std::replace(loop.pre->succs.begin(), loop.pre->succs.end(), header, head);
+
+    // past the loop its final counter and reduction come from either side
+    BasicBlock* exit = loop.exit;
+    auto from_kernels = [&](const Operand& opnd) {
+        if (opnd == Operand::vreg(loop.next)) { return fin; }
+        if (loop.red >= 0 && opnd == Operand::vreg(loop.red_next)) { return red_fin; }
+        return opnd;
+    };
+    int slot = std::find(exit->preds.begin(), exit->preds.end(), header) - exit->preds.begin();
+    std::vector<IRInst> merges;
+    if (exit->preds.size() == 1) {
+        // nothing merged there so far, later uses read the loop's values
+        std::vector<std::pair<int, int>> renamed;
+        for (int v : {loop.next, loop.red_next}) {
+            if (v >= 0) { renamed.push_back({v, func->new_vreg()}); }
+        }
+        for (auto* bb : func->blocks) {
+            if (bb == header) { continue; }
+            for (auto& inst : bb->insts) {
+                if (bb == exit && inst.op == _IR_PHI_) { continue; }
+                for (auto& arg : inst.args) {
+                    for (auto& r : renamed) {
+                        if (arg == Operand::vreg(r.first)) { arg = Operand::vreg(r.second); }
+                    }
+                }
+            }
+        }
+        for (auto& r : renamed) { merges.push_back(IRInst(_IR_PHI_, r.second, {Operand::vreg(r.first), from_kernels(Operand::vreg(r.first))})); }
+    }
+    for (auto& inst : exit->insts) {
+        if (inst.op != _IR_PHI_) { break; }
+        inst.args.push_back(from_kernels(inst.args[slot]));
+    }
+    exit->insts.insert(exit->insts.begin(), merges.begin(), merges.end());
+    exit->preds.push_back(done);
+    head->preds = {loop.pre};
+
+    func->blocks.insert(func->blocks.begin() + header->index, added.begin(), added.end());
+    func->rebuild_cfg();
+};
+
+void vectorize_loops(IRModule* mod, SimdISA isa) {
+    if (isa == _SIMD_NONE_) { return; }
+    std::vector<SimdISA> targets = {isa};
+    if (isa == _SIMD_DISPATCH_) { targets = {_SIMD_AVX2_, _SIMD_SSE42_}; }
+
+    for (auto* func : mod->funcs) {
+        std::vector<BasicBlock*> headers;
+        for (auto* bb : func->blocks) {
+            if (std::count(bb->succs.begin(), bb->succs.end(), bb)) { headers.push_back(bb); }
+        }
+
+        for (auto* bb : headers) {
+            std::vector<char> defined(func->num_vregs, 0);
+            for (auto& inst : bb->insts) {
+                if (inst.dst >= 0) { defined[inst.dst] = 1; }
+            }
+            CountedLoop loop;
+            if (!match_loop(bb, defined, loop)) { continue; }
+
+            // only the final counter and reduction may be read past the loop
+            bool escapes = false;
+            for (auto* other : func->blocks) {
+                if (other == bb) { continue; }
+                for (auto& inst : other->insts) {
+                    for (auto& arg : inst.args) {
+                        if (arg.is_vreg() && defined[arg.val] && arg.val != loop.next && arg.val != loop.red_next) { escapes = true; }
+                    }
+                }
+            }
+            if (escapes) { continue; }
+
+            std::vector<IRInst> kernels;
+            for (SimdISA target : targets) {
+                kernels.push_back(IRInst(_IR_VLOOP_, -1, {}));
+                if (!build_kernel(func, loop, defined, target, kernels.back())) { kernels.pop_back(); }
+            }
+            if (kernels.size() == targets.size()) { vectorize_loop(func, loop, kernels, isa == _SIMD_DISPATCH_); }
+        }
+    }
+};